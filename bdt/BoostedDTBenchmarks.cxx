@@ -13,30 +13,216 @@
 
 #include "benchmark/benchmark.h"
 
+#include <chrono>
+#include <thread>
+
 #include "utils/MakeRandomTTree.h"
+#include "utils/RandomColumnCache.h"
 #include "utils/root2xgboost.h"
+#include "utils/DMatrixCache.h"
+#include "utils/AllocRecorder.h"
+#include "utils/ClassifierQuality.h"
+#include "utils/PerfRecorder.h"
+#include "utils/PhaseTimer.h"
+#include "utils/FlatForest.h"
+#include "utils/FlatForestSIMD.h"
+#include "utils/FlatForestFile.h"
+#include "utils/ForestCodegen.h"
+#include "utils/ForestConvert.h"
+#include "utils/LatencyRecorder.h"
+#include "utils/QuickScorer.h"
+#include "utils/ThreadBudget.h"
+#include "utils/ThreadScaling.h"
 
 using namespace TMVA::Experimental;
 using namespace std;
 
+// Generator settings of the HEP-like samples (correlated, non-linearly separated and heavy-tailed) used for training and
+// testing, such that the trainers are loaded as they would be by production physics samples
+static const hep_gen_opts hepOpts;
+
+// Data-size and feature-count scaling sweeps, carried out at a fixed forest size and thread count. The arguments are
+// (NTrees, MaxDepth, threads, nEvents, nVars) followed by any extra arguments of the benchmark, which testing
+// benchmarks share with training so that each trained model is tested at the width it was trained with.
+static void addBDTScalingArgs(benchmark::internal::Benchmark* b, const vector<int64_t>& extra){
+   auto add = [&](int64_t nEvents, int64_t nVars){
+      vector<int64_t> args = {100, 6, 1, nEvents, nVars};
+      args.insert(args.end(), extra.begin(), extra.end());
+      b->Args(args);
+   };
+
+   for(int64_t nEvents: {1000, 10000, 100000, 1000000, 10000000}){
+      add(nEvents, 4);
+   }
+   for(int64_t nVars: {16, 64, 128, 256, 500}){
+      add(10000, nVars);
+   }
+}
+static void BDTScalingArgs(benchmark::internal::Benchmark* b){ addBDTScalingArgs(b, {}); }
+static void XGBoostTrainingScalingArgs(benchmark::internal::Benchmark* b){ addBDTScalingArgs(b, {0}); }
+
+// Thread-scaling sweep, from one thread up to all hardware threads of the machine (see thread_sweep), at a fixed forest
+// and data set size, with the same argument layout as addBDTScalingArgs.
+static void addThreadScalingArgs(benchmark::internal::Benchmark* b, const vector<int64_t>& extra){
+   for(int64_t threads: thread_sweep()){
+      vector<int64_t> args = {100, 6, threads, 100000, 16};
+      args.insert(args.end(), extra.begin(), extra.end());
+      b->Args(args);
+   }
+}
+static void ThreadScalingArgs(benchmark::internal::Benchmark* b){ addThreadScalingArgs(b, {}); }
+static void XGBoostTrainingThreadScalingArgs(benchmark::internal::Benchmark* b){ addThreadScalingArgs(b, {0}); }
+
+// Chunk-size sweep of the streaming conversion (0 converting in memory), at data set sizes for which the memory held
+// by an in-memory conversion matters, with the argument layout of XGBoostTrainingScalingArgs.
+static void XGBoostChunkSizeArgs(benchmark::internal::Benchmark* b){
+   for(int64_t nEvents: {100000, 1000000, 10000000}){
+      for(int64_t chunk_size: {0, 4096, 65536, 1048576}){
+         b->Args({100, 6, 1, nEvents, 16, chunk_size});
+      }
+   }
+}
+
+/* Files of the models trained by BM_TMVA_BDTTraining and BM_XGBOOST_BDTTraining, named after every parameter of the
+ * training configuration, such that the models of different configurations (e.g. of a data size sweep) never
+ * overwrite each other: the forest size, the number of threads (TMVA only, as TMVA names its weights after the method),
+ * the number of events (of each class) and variables, and the chunk size of a streaming conversion (XGBoost only, if
+ * non-zero). Inference benchmarks load the model of the exact training configuration they name.
+ */
+static string tmvaMethodName(int64_t nTrees, int64_t maxDepth, int64_t threads, int64_t nEvents, int64_t nVars){
+   return "BDT_" + to_string(nTrees) + "_" + to_string(maxDepth) + "_" + to_string(threads) + "_" + to_string(nEvents) +
+          "_" + to_string(nVars);
+}
+static string tmvaWeightsFile(int64_t nTrees, int64_t maxDepth, int64_t threads, int64_t nEvents, int64_t nVars){
+   return "./bdt_tmva_bench/weights/bdt_tmva_bench_" + tmvaMethodName(nTrees, maxDepth, threads, nEvents, nVars) +
+          ".weights.xml";
+}
+static string xgboostModelFile(int64_t nTrees, int64_t maxDepth, int64_t nEvents, int64_t nVars, int64_t chunkSize = 0){
+   return "BDT_" + to_string(nTrees) + "_" + to_string(maxDepth) + "_" + to_string(nEvents) + "_" + to_string(nVars) +
+          (chunkSize > 0 ? "_c" + to_string(chunkSize) : "") + ".model";
+}
+
+// Training configuration of the grid of forest sizes of the training benchmarks, whose single-threaded models are the
+// ones loaded by the benchmarks sweeping forest sizes only (model loading and the inference engines)
+static const int64_t gridEvents = 500, gridVars = 4;
+
+// Signal (or background) test sample, of other seeds than the training samples, shared by the testing benchmarks
+static random_columns* testColumnsCached(UInt_t nEvents, UInt_t nVars, bool signal = true){
+   return genHEPColumnsCached(signal ? "testTree" : "bkgTree", nEvents, nVars, signal, hepOpts, signal ? 102 : 103,
+                              false);
+}
+
+// Quality of the trained models, on independent signal and background test samples (of other seeds than the training
+// samples) of a fixed size, such that the counters are comparable across configurations
+static const UInt_t qualityEvents = 10000;
+
+/* The output of a TMVA BDT is mapped from [-1, 1] to [0, 1], which for gradient boosting is the signal probability
+ * (a logistic function of the margin), whereas for AdaBoost it is a weighted vote of the trees, not calibrated:
+ * the log-loss is hence only reported for gradient boosted forests.
+ */
+static void reportTMVAQuality(benchmark::State &state, const string& weights, UInt_t nVars, bool gradBoosted){
+   classifier_quality quality;
+   RReader model(weights);
+   for(Bool_t signal: {true, false}){
+      random_columns* columns = testColumnsCached(qualityEvents, nVars, signal);
+      auto tensor = columns->AsTensor();
+      auto out = model.Compute(tensor);
+
+      // The BDT output is in [-1, 1], from background to signal
+      for(UInt_t i = 0; i < qualityEvents; i++){ quality.Add((out.GetData()[i] + 1.0) / 2.0, signal); }
+      delete columns;
+   }
+   quality.Report(state, gradBoosted);
+}
+
+/* The XGBoost boosters are trained with the default reg:squarederror objective, whose outputs are unbounded regression
+ * scores rather than probabilities: the log-loss is hence not reported for them.
+ */
+static void reportXGBoostQuality(benchmark::State &state, const string& model, UInt_t nVars){
+   classifier_quality quality;
+   BoosterHandle xgbooster;
+   safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+   safe_xgboost(XGBoosterLoadModel(xgbooster, model.c_str()))
+   for(Bool_t signal: {true, false}){
+      random_columns* columns = testColumnsCached(qualityEvents, nVars, signal);
+      vector<Float_t> rows = columns->AsRows();
+
+      DMatrixHandle dmat;
+      bst_ulong output_length;
+      const Float_t *output_result;
+      safe_xgboost(XGDMatrixCreateFromMat(rows.data(), qualityEvents, nVars, NAN, &dmat))
+      safe_xgboost(XGBoosterPredict(xgbooster, dmat, 0, 0, &output_length, &output_result))
+
+      // Boosters are trained on labels of 0 for signal and 1 for background (see root2xgboost.h)
+      for(UInt_t i = 0; i < qualityEvents; i++){ quality.Add(1.0 - output_result[i], signal); }
+      safe_xgboost(XGDMatrixFree(dmat))
+      delete columns;
+   }
+   safe_xgboost(XGBoosterFree(xgbooster))
+   quality.Report(state, false);
+}
+
+/* Training throughput normalised by the work done, from the forest actually produced (TMVA and XGBoost may build
+ * fewer or smaller trees than requested) and the boosting time per iteration: (event, tree) pairs and nodes built per
+ * second, and the time per boosting round (i.e. per tree).
+ */
+static void reportTrainingRates(benchmark::State &state, const flat_forest& forest, UInt_t nEvents,
+                                double boostingTime){
+   state.counters["Trees Built"] = forest.n_trees;
+   state.counters["Nodes Built"] = forest.n_nodes;
+   if(boostingTime <= 0.0 || forest.n_trees == 0){ return; }
+   state.counters["Event Trees per Second"] = 1.0 * nEvents * forest.n_trees / boostingTime;
+   state.counters["Nodes per Second"] = forest.n_nodes / boostingTime;
+   state.counters["Time per Round"] = boostingTime / forest.n_trees;
+}
+
+/* Writes the trees created in the given file and closes it (deleting the trees, which the file owns), then reopens it
+ * read-only, such that the trees are read back from disk; multi-threaded event loops open their own readers on the file
+ * of a tree, which must hence be complete on disk.
+ */
+static TFile* reopenReadOnly(TFile* file, const char* fileName){
+   file->Write();
+   file->Close();
+   delete file;
+
+   TFile* reopened = TFile::Open(fileName, "READ");
+   if(reopened == nullptr || reopened->IsZombie()){
+      throw runtime_error(string("Failed to reopen ") + fileName);
+   }
+   return reopened;
+}
+
+// Re-saves a saved XGBoost booster in the given model format (next to it), returning the path of the re-saved model.
+static string resaveXGBoostModel(const string& model, xgboost_model_format format = kModelJSON){
+   BoosterHandle xgbooster;
+   safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+   safe_xgboost(XGBoosterLoadModel(xgbooster, model.c_str()))
+   string path = xgboost_save_model(xgbooster, model.substr(0, model.rfind('.')), format);
+   safe_xgboost(XGBoosterFree(xgbooster))
+
+   return path;
+}
+
+// Loads the forest of a saved XGBoost booster, through its JSON model (written next to it).
+static flat_forest* loadXGBoostFlatForest(const string& model){
+   return XGBoostToFlatForest(resaveXGBoostModel(model));
+}
+
 static void BM_TMVA_BDTTraining(benchmark::State &state){
    // Parameters
-   UInt_t nVars = 4;
-   UInt_t nEvents = 500;
-   Bool_t mem_stats = (state.range(0) == 2000) && (state.range(1) == 10) && (state.range(2) == 1);
+   UInt_t nEvents = state.range(3);
+   UInt_t nVars = state.range(4);
 
-   // Memory benchmark data placeholder
-   ProcInfo_t pinfo;
-   Long_t init_mem_res, term_mem_res; init_mem_res = term_mem_res = 0;
-   double mem_res = 0.0;
+   // Allocations made by the training step of each iteration
+   alloc_recorder allocs;
 
    // Open output file
    TString outfileName( "bdt_tmva_bench_train_output.root" );
    TFile* outputFile = TFile::Open(outfileName, "RECREATE");
 
    // Set up
-   TTree *sigTree = genTree("sigTree", nEvents, nVars,0.3, 0.5, 100);
-   TTree *bkgTree = genTree("bkgTree", nEvents, nVars,-0.3, 0.5, 101);
+   TTree *sigTree = genHEPTreeCached("sigTree", nEvents, nVars, true, hepOpts, 100);
+   TTree *bkgTree = genHEPTreeCached("bkgTree", nEvents, nVars, false, hepOpts, 101);
 
    // Prepare a DataLoader instance, registering the signal and background TTrees
    auto *dataloader = new TMVA::DataLoader("bdt_tmva_bench");
@@ -54,37 +240,43 @@ static void BM_TMVA_BDTTraining(benchmark::State &state){
    dataloader->PrepareTrainingAndTestTree("",
                   Form("SplitMode=Block:nTrain_Signal=%i:nTrain_Background=%i:!V", nEvents, nEvents));
 
-   // Benchmarking
-   UInt_t iter_c = 0;
+   string method_name = tmvaMethodName(state.range(0), state.range(1), state.range(2), nEvents, nVars);
+
+   // Benchmarking, broken down into phases; TrainMethod covers the boosting itself (which TMVA times on its own, see
+   // "Boosting Time") as well as the evaluation of the training sample and the writing of the weight file
+   phase_timer phases;
+   Double_t boosting_time = 0.0;
+   perf_recorder perf;
+   thread_scaling scaling(state.range(2));
    for(auto _: state){
+      phases.Start("Setup");
       ROOT::EnableImplicitMT(state.range(2));
 
       // Create factory instance
       auto factory = new TMVA::Factory("bdt_tmva_bench", outputFile,
                                     "Silent:!DrawProgressBar:AnalysisType=Classification");
 
-      // Get current memory usage statistics after setup
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         init_mem_res = pinfo.fMemResident;
-      }
-      
+      // The data set is built from the TTrees when first accessed, i.e. in the first iteration only
+      phases.Start("Data Preparation");
+      dataloader->GetDefaultDataSetInfo().GetDataSet();
+
+      // Allocations are tracked from the booking of the method onwards
+      phases.Start("Setup");
+      allocs.Start();
+
       // Construct training options string
       string opts = "!V:!H:NTrees=" + to_string(state.range(0)) + ":MaxDepth=" + to_string(state.range(1));
 
       // Train a TMVA method
-      string key = to_string(state.range(0)) + "_" + to_string(state.range(1)) + "_" + to_string(state.range(2));
-      auto method = factory->BookMethod(dataloader, TMVA::Types::kBDT, "BDT_" + key, opts);
+      auto method = factory->BookMethod(dataloader, TMVA::Types::kBDT, method_name, opts);
+
+      phases.Start("Training");
       TMVA::Event::SetIsTraining(kTRUE);
       method->TrainMethod();
+      allocs.Stop();
+      boosting_time += method->GetTrainTime();
 
-      // Maintain Memory statistics (independent from Google Benchmark)
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         term_mem_res = pinfo.fMemResident;
-         mem_res += (double) (term_mem_res - init_mem_res);
-      }
-
+      phases.Start("Teardown");
       TMVA::Event::SetIsTraining(kFALSE);
       method->Data()->DeleteAllResults(TMVA::Types::kTraining, method->GetAnalysisType());
 
@@ -92,14 +284,51 @@ static void BM_TMVA_BDTTraining(benchmark::State &state){
       factory->DeleteAllMethods();
       factory->fMethodsMap.clear();
       delete factory;
-
-      iter_c++;
-   }
-
-   if(mem_stats){
-      mem_res *= iter_c;
-      state.counters["Resident Memory"] = benchmark::Counter(mem_res, benchmark::Counter::kAvgIterations);
+      phases.Stop();
    }
+   perf.Report(state);
+
+   // Single-thread reference of the speedup, training the method of the single-thread configuration (the pool of the
+   // implicit multi-threading being disabled afterwards, such that the next configuration gets a pool of its size)
+   ROOT::DisableImplicitMT();
+   ROOT::EnableImplicitMT(1);
+   scaling.Report(state, [&](){
+      auto start = chrono::steady_clock::now();
+      auto factory = new TMVA::Factory("bdt_tmva_bench", outputFile,
+                                    "Silent:!DrawProgressBar:AnalysisType=Classification");
+      dataloader->GetDefaultDataSetInfo().GetDataSet();
+      string opts = "!V:!H:NTrees=" + to_string(state.range(0)) + ":MaxDepth=" + to_string(state.range(1));
+      auto method = factory->BookMethod(dataloader, TMVA::Types::kBDT,
+                                        tmvaMethodName(state.range(0), state.range(1), 1, nEvents, nVars), opts);
+      TMVA::Event::SetIsTraining(kTRUE);
+      method->TrainMethod();
+      TMVA::Event::SetIsTraining(kFALSE);
+      method->Data()->DeleteAllResults(TMVA::Types::kTraining, method->GetAnalysisType());
+      factory->DeleteAllMethods();
+      factory->fMethodsMap.clear();
+      delete factory;
+      chrono::duration<double> time = chrono::steady_clock::now() - start;
+      return time.count();
+   });
+   ROOT::DisableImplicitMT();
+   allocs.Report(state);
+
+   phases.Report(state);
+   state.counters["Boosting Time"] = benchmark::Counter(boosting_time, benchmark::Counter::kAvgIterations);
+
+   // Normalised throughput and quality of the model trained (by the last iteration)
+   string weights = tmvaWeightsFile(state.range(0), state.range(1), state.range(2), nEvents, nVars);
+   flat_forest* forest = TMVAToFlatForest(weights);
+   reportTrainingRates(state, *forest, 2 * nEvents, boosting_time / state.iterations());
+   bool gradientBoosted = (forest->transform == kForestTMVAGrad);
+   forest->free();
+   delete forest;
+   reportTMVAQuality(state, weights, nVars, gradientBoosted);
+
+   // Training throughput, in (signal and background) events and feature values per second
+   state.SetItemsProcessed(state.iterations() * 2 * nEvents);
+   state.counters["Feature Values"] = benchmark::Counter(2.0 * nEvents * nVars,
+                                                         benchmark::Counter::kIsIterationInvariantRate);
 
    // Teardown
    delete sigTree;
@@ -108,26 +337,26 @@ static void BM_TMVA_BDTTraining(benchmark::State &state){
    outputFile->Close();
    delete outputFile;
 }
-BENCHMARK(BM_TMVA_BDTTraining)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}});
+BENCHMARK(BM_TMVA_BDTTraining)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}, {gridEvents},
+                                             {gridVars}});
+BENCHMARK(BM_TMVA_BDTTraining)->Apply(BDTScalingArgs);
+BENCHMARK(BM_TMVA_BDTTraining)->Apply(ThreadScalingArgs);
 
 static void BM_XGBOOST_BDTTraining(benchmark::State &state){
    // Parameters
-   UInt_t nVars = 4;
-   UInt_t nEvents = 500;
-   Bool_t mem_stats = (state.range(0) == 2000) && (state.range(1) == 10) && (state.range(2) == 1);
+   UInt_t nEvents = state.range(3);
+   UInt_t nVars = state.range(4);
 
-   // Memory benchmark data placeholder
-   ProcInfo_t pinfo;
-   Long_t init_mem_res, term_mem_res; init_mem_res = term_mem_res = 0;
-   double mem_res = 0.0;
+   // Allocations made by the training step of each iteration
+   alloc_recorder allocs;
 
    // Open output file
    TString outfileName( "bdt_xgb_bench_train_output.root" );
    TFile* outputFile = TFile::Open(outfileName, "RECREATE");
 
    // Set up
-   TTree *sigTree = genTree("sigTree", nEvents, nVars,0.3, 0.5, 100);
-   TTree *bkgTree = genTree("bkgTree", nEvents, nVars,-0.3, 0.5, 101);
+   TTree *sigTree = genHEPTreeCached("sigTree", nEvents, nVars, true, hepOpts, 100);
+   TTree *bkgTree = genHEPTreeCached("bkgTree", nEvents, nVars, false, hepOpts, 101);
 
    // Prepare a DataLoader instance, registering the signal and background TTrees
    auto *dataloader = new TMVA::DataLoader("bdt_xgb_bench");
@@ -135,58 +364,120 @@ static void BM_XGBOOST_BDTTraining(benchmark::State &state){
    dataloader->AddBackgroundTree(bkgTree);
 
    // Register variables in dataloader, using naming convention for randomly generated TTrees in MakeRandomTTree.h
+   vector<string> variables;
    for(UInt_t i = 0; i < nVars; i++){
       string var_name = "var" + to_string(i);
       string var_leaflist = var_name + "/F";
 
       dataloader->AddVariable(var_name.c_str(), 'D');
+      variables.push_back(var_name);
    }
 
-   dataloader->PrepareTrainingAndTestTree("",
-                  Form("SplitMode=Block:nTrain_Signal=%i:nTrain_Background=%i:!V", nEvents, nEvents));
+   string split = Form("SplitMode=Block:nTrain_Signal=%i:nTrain_Background=%i:!V", nEvents, nEvents);
+   dataloader->PrepareTrainingAndTestTree("", split.c_str());
+
+   // Extract the training data set (all the events of the trees) and convert it to an XGBoost readable format; a
+   // non-zero chunk size selects the streaming conversion, which reads the events from the trees one chunk at a time,
+   // bounding the memory held by the conversion to a single chunk of events, whereas in-memory DMatrix instances are
+   // taken from (or stored to) the on-disk DMatrix cache, keyed by the column caches the trees are built from
+   Long64_t chunk_size = state.range(5);
+   Int_t max_bin = 256;
+   string source = random_hep_columns_path("sigTree", nEvents, nVars, true, hepOpts, 100, true) + ";" +
+                   random_hep_columns_path("bkgTree", nEvents, nVars, false, hepOpts, 101, true) + ";" + split;
+   if(chunk_size == 0){
+      dataloader->GetDefaultDataSetInfo().GetDataSet(); // built lazily by TMVA, which is not part of the conversion
+   }
+
+   RB::AllocTracker conv_allocs;
+   auto conv_start = chrono::steady_clock::now();
+
+   xgboost_data* xg_train_data;
+   if(chunk_size > 0){
+      xg_train_data = ROOTToXGBoost(*sigTree, *bkgTree, variables, chunk_size);
+   }else{
+      bool cache_hit;
+      xg_train_data = ROOTToXGBoostCached(dataloader->GetDefaultDataSetInfo(), TMVA::Types::kTraining, source,
+                                          &cache_hit);
+      chrono::duration<double> cache_time = chrono::steady_clock::now() - conv_start;
+      state.counters[cache_hit ? "DMatrix Cache Hit" : "DMatrix Cold Build"] = cache_time.count();
+   }
 
-   // Extract the training data set and convert it to an XGBoost readable format
-   xgboost_data* xg_train_data = ROOTToXGBoost(dataloader->GetDefaultDataSetInfo(), TMVA::Types::kTraining);
+   chrono::duration<double> conv_time = chrono::steady_clock::now() - conv_start;
+   RB::AllocStats conv_stats = conv_allocs.Stop();
+   state.counters["Conversion Time"] = conv_time.count();
+   state.counters["Conversion Allocated Bytes"] = conv_stats.fAllocatedBytes;
+   state.counters["Conversion Peak Live Bytes"] = conv_stats.fPeakLiveBytes;
 
-   // Benchmarking
-   UInt_t iter_c = 0;
+   string fname = xgboostModelFile(state.range(0), state.range(1), nEvents, nVars, chunk_size);
+
+   // Benchmarking, broken down into phases (the data preparation being the conversion above)
+   phase_timer phases;
+   perf_recorder perf;
+   thread_scaling scaling(state.range(2));
    for(auto _: state){
-      // Set the options for the BoosterHandle instance that will be trained...
-      xgbooster_opts opts;
-      opts.push_back(kv_pair("max_depth", std::to_string((int) state.range(1)).c_str()));
-      opts.push_back(kv_pair("nthread", std::to_string((int) state.range(2)).c_str()));
-      opts.push_back(kv_pair("eta", "0.01"));
+      phases.Start("Setup");
 
-      // Get current memory usage statistics after setup
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         init_mem_res = pinfo.fMemResident;
-      }
+      // Set the options for the BoosterHandle instance that will be trained (the option values must outlive opts)...
+      string max_depth = to_string((int) state.range(1));
+      string nthread = to_string((int) state.range(2));
+      string max_bin_str = to_string(max_bin);
 
-      // Call the simple trainer function we implemented based on XGBoost's C-api...
-      BoosterHandle xgbooster = xgboost_train(xg_train_data, &opts, state.range(0));
+      xgbooster_opts opts;
+      opts.push_back(kv_pair("max_depth", max_depth.c_str()));
+      opts.push_back(kv_pair("nthread", nthread.c_str()));
+      opts.push_back(kv_pair("eta", "0.01"));
+      opts.push_back(kv_pair("max_bin", max_bin_str.c_str()));
 
-      // Maintain Memory statistics (independent from Google Benchmark)
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         term_mem_res = pinfo.fMemResident;
-         mem_res += (double) (term_mem_res - init_mem_res);
-      }
+      // Train the booster based on XGBoost's C-api...
+      allocs.Start();
+      BoosterHandle xgbooster = xgboost_create_booster(xg_train_data, &opts);
 
-      iter_c++;
+      phases.Start("Boosting");
+      xgboost_boost(xgbooster, xg_train_data, state.range(0));
+      allocs.Stop();
 
       // Save XGBoost trained booster instance
-      string fname = "BDT_" + to_string(state.range(0)) + "_" + to_string(state.range(1)) + ".model";
+      phases.Start("Serialisation");
       safe_xgboost(XGBoosterSaveModel(xgbooster, fname.c_str()))
 
       // Free XGBoost related memory
+      phases.Start("Teardown");
       safe_xgboost(XGBoosterFree(xgbooster))
+      phases.Stop();
    }
+   perf.Report(state);
 
-   if(mem_stats){
-      mem_res *= iter_c;
-      state.counters["Resident Memory"] = benchmark::Counter(mem_res, benchmark::Counter::kAvgIterations);
-   }
+   // Single-thread reference of the speedup, which does not save its booster (keeping the one trained above)
+   scaling.Report(state, [&](){
+      auto start = chrono::steady_clock::now();
+      string max_depth = to_string((int) state.range(1));
+      string max_bin_str = to_string(max_bin);
+
+      xgbooster_opts opts;
+      opts.push_back(kv_pair("max_depth", max_depth.c_str()));
+      opts.push_back(kv_pair("nthread", "1"));
+      opts.push_back(kv_pair("eta", "0.01"));
+      opts.push_back(kv_pair("max_bin", max_bin_str.c_str()));
+
+      BoosterHandle xgbooster = xgboost_train(xg_train_data, &opts, state.range(0));
+      safe_xgboost(XGBoosterFree(xgbooster))
+      chrono::duration<double> time = chrono::steady_clock::now() - start;
+      return time.count();
+   });
+   allocs.Report(state);
+   phases.Report(state);
+
+   // Normalised throughput and quality of the model trained (by the last iteration)
+   flat_forest* forest = loadXGBoostFlatForest(fname);
+   reportTrainingRates(state, *forest, 2 * nEvents, phases.Time("Boosting") / state.iterations());
+   forest->free();
+   delete forest;
+   reportXGBoostQuality(state, fname, nVars);
+
+   // Training throughput, in (signal and background) events and feature values per second
+   state.SetItemsProcessed(state.iterations() * 2 * nEvents);
+   state.counters["Feature Values"] = benchmark::Counter(2.0 * nEvents * nVars,
+                                                         benchmark::Counter::kIsIterationInvariantRate);
 
    // Teardown
    delete sigTree;
@@ -196,90 +487,133 @@ static void BM_XGBOOST_BDTTraining(benchmark::State &state){
    outputFile->Close();
    delete outputFile;
 }
-BENCHMARK(BM_XGBOOST_BDTTraining)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}});
+BENCHMARK(BM_XGBOOST_BDTTraining)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}, {gridEvents},
+                                                {gridVars}, {0}});
+BENCHMARK(BM_XGBOOST_BDTTraining)->Apply(XGBoostTrainingScalingArgs);
+BENCHMARK(BM_XGBOOST_BDTTraining)->Apply(XGBoostTrainingThreadScalingArgs);
+BENCHMARK(BM_XGBOOST_BDTTraining)->Apply(XGBoostChunkSizeArgs);
 
 static void BM_TMVA_BDTTesting(benchmark::State &state){
    // Parameters
-   UInt_t nVars = 4;
-   UInt_t nEvents = 500;
-   Bool_t mem_stats = (state.range(0) == 2000) && (state.range(1) == 10) && (state.range(2) == 1);
+   UInt_t nEvents = state.range(3);
+   UInt_t nVars = state.range(4);
 
-   // Memory benchmark data placeholder
-   ProcInfo_t pinfo;
-   Long_t init_mem_res, term_mem_res; init_mem_res = term_mem_res = 0;
-   double mem_res = 0.0;
+   // Allocations made by the testing step of each iteration
+   alloc_recorder allocs;
 
    // Open output file
    TString outfileName( "bdt_tmva_bench_test_output.root" );
    TFile* outputFile = TFile::Open(outfileName, "RECREATE");
 
-   // Set up
-   auto inputFile = new TFile("bdt_tmva_bench_test_input.root","RECREATE");
-   TTree *testTree = genTree("testTree", nEvents, nVars,0.3, 0.5, 102, false);
-   testTree->Write();
-   delete testTree;
-   inputFile->Close();
-   delete inputFile;
+   // Set up: attach to the cached test data set, viewing its columns as a tensor without deserialising a TTree
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   auto testTensor = testColumns->AsTensor();
 
-   ROOT::RDataFrame testDF("testTree","bdt_tmva_bench_test_input.root");
-   auto testTensor = AsTensor<Float_t>(testDF);
+   // Load the TMVA method via RReader (see BM_TMVA_ModelLoading for the cost of parsing the weights)
+   ROOT::EnableImplicitMT(state.range(2));
+   RReader model(tmvaWeightsFile(state.range(0), state.range(1), state.range(2), nEvents, nVars));
 
    // Benchmarking
-   UInt_t iter_c = 0;
+   perf_recorder perf;
+   thread_scaling scaling(state.range(2));
    for(auto _: state){
-      ROOT::EnableImplicitMT(state.range(2));
+      // Test the TMVA method
+      allocs.Start();
+      model.Compute(testTensor);
+      allocs.Stop();
+   }
+   perf.Report(state);
 
-      // Test a TMVA method via RReader
-      string key = to_string(state.range(0)) + "_" + to_string(state.range(1)) + "_" + to_string(state.range(2));
+   // Single-thread reference of the speedup (the pool of the implicit multi-threading being disabled afterwards)
+   ROOT::DisableImplicitMT();
+   ROOT::EnableImplicitMT(1);
+   scaling.Report(state, [&](){
+      auto start = chrono::steady_clock::now();
+      model.Compute(testTensor);
+      chrono::duration<double> time = chrono::steady_clock::now() - start;
+      return time.count();
+   });
+   ROOT::DisableImplicitMT();
+   allocs.Report(state);
 
-      // Get current memory usage statistics after setup
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         init_mem_res = pinfo.fMemResident;
-      }
+   // Testing throughput, in events and feature values per second
+   state.SetItemsProcessed(state.iterations() * nEvents);
+   state.counters["Feature Values"] = benchmark::Counter(1.0 * nEvents * nVars,
+                                                         benchmark::Counter::kIsIterationInvariantRate);
 
-      RReader model("./bdt_tmva_bench/weights/bdt_tmva_bench_BDT_" + key + ".weights.xml");
-      model.Compute(testTensor);
+   // Teardown
+   delete testColumns;
 
-      // Maintain Memory statistics (independent from Google Benchmark)
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         term_mem_res = pinfo.fMemResident;
-         mem_res += (double) (term_mem_res - init_mem_res);
-      }
+   outputFile->Close();
+}
+BENCHMARK(BM_TMVA_BDTTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}, {gridEvents},
+                                            {gridVars}});
+//BENCHMARK(BM_TMVA_BDTTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1}, {500}, {4}});
+BENCHMARK(BM_TMVA_BDTTesting)->Apply(BDTScalingArgs);
+BENCHMARK(BM_TMVA_BDTTesting)->Apply(ThreadScalingArgs);
 
-      iter_c++;
-   }
+static void BM_FlatForest_TMVATesting(benchmark::State &state){
+   // Parameters
+   UInt_t nEvents = state.range(3);
+   UInt_t nVars = state.range(4);
 
-   if(mem_stats){
-      mem_res *= iter_c;
-      state.counters["Resident Memory"] = benchmark::Counter(mem_res, benchmark::Counter::kAvgIterations);
+   // Set up: the test data set of BM_TMVA_BDTTesting, scored straight from its (column-major) mapped columns
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   vector<Float_t> scores(nEvents);
+
+   // Load the forest trained by BM_TMVA_BDTTraining into the native inference engine
+   string weights = tmvaWeightsFile(state.range(0), state.range(1), state.range(2), nEvents, nVars);
+
+   auto load_start = chrono::steady_clock::now();
+   flat_forest* forest = TMVAToFlatForest(weights);
+   chrono::duration<double> load_time = chrono::steady_clock::now() - load_start;
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      forest->Predict(testColumns->Column(0), nEvents, 1, nEvents, scores.data(), state.range(2));
    }
+   perf.Report(state);
+
+   state.counters["Load Time"] = load_time.count();
+
+   // Largest deviation from the scores of RReader on the same events, which should be down to float rounding only
+   RReader model(weights);
+   auto testTensor = testColumns->AsTensor();
+   auto reference = model.Compute(testTensor);
+   double max_dev = 0.0;
+   for(UInt_t i = 0; i < nEvents; i++){ max_dev = max(max_dev, (double) fabs(scores[i] - reference.GetData()[i])); }
+   state.counters["Max Deviation"] = max_dev;
+
+   // Testing throughput, in events and feature values per second
+   state.SetItemsProcessed(state.iterations() * nEvents);
+   state.counters["Feature Values"] = benchmark::Counter(1.0 * nEvents * nVars,
+                                                         benchmark::Counter::kIsIterationInvariantRate);
 
    // Teardown
-   outputFile->Close();
+   forest->free();
+   delete forest;
+   delete testColumns;
 }
-BENCHMARK(BM_TMVA_BDTTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}});
-//BENCHMARK(BM_TMVA_BDTTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1}});
+BENCHMARK(BM_FlatForest_TMVATesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16},
+                                                  {gridEvents}, {gridVars}});
+BENCHMARK(BM_FlatForest_TMVATesting)->Apply(BDTScalingArgs);
 
 static void BM_XGBOOST_BDTTesting(benchmark::State &state){
    // Parameters
-   UInt_t nVars = 4;
-   UInt_t nEvents = 250; // half size since DataLoader requires test data to be split between signal and background...
-   Bool_t mem_stats = (state.range(0) == 2000) && (state.range(1) == 10) && (state.range(2) == 1);
+   UInt_t nEvents = state.range(3) / 2; // half size since DataLoader requires test data to be split between signal and background...
+   UInt_t nVars = state.range(4);
 
-   // Memory benchmark data placeholder
-   ProcInfo_t pinfo;
-   Long_t init_mem_res, term_mem_res; init_mem_res = term_mem_res = 0;
-   double mem_res = 0.0;
+   // Allocations made by the testing step of each iteration
+   alloc_recorder allocs;
 
    // Open output file
    TString outfileName( "bdt_xgb_bench_test_output.root" );
    TFile* outputFile = TFile::Open(outfileName, "RECREATE");
 
    // Set up (create one additional event to silence TMVA DataLoader error for no training events)
-   TTree *testTree = genTree("testTree", nEvents + 1, nVars, 0.3, 0.5, 102);
-   TTree *trainBKGTree = genTree("bkgTree", nEvents + 1, nVars, 0.3, 0.5, 103);
+   TTree *testTree = genHEPTreeCached("testTree", nEvents + 1, nVars, true, hepOpts, 102);
+   TTree *trainBKGTree = genHEPTreeCached("bkgTree", nEvents + 1, nVars, false, hepOpts, 103);
 
    // Prepare a DataLoader instance, registering the testing TTrees
    auto *dataloader = new TMVA::DataLoader("bdt_xgb_bench");
@@ -298,57 +632,1084 @@ static void BM_XGBOOST_BDTTesting(benchmark::State &state){
    dataloader->PrepareTrainingAndTestTree("",
       Form("SplitMode=Block:nTrain_Signal=%i:nTrain_Background=%i:nTest_Signal=%i:nTest_Background=%i:!V", 1, 1, nEvents, nEvents));
 
+   // Load the trained booster model (see BM_XGBOOST_ModelLoading for the cost of loading it)...
+   string fname = xgboostModelFile(state.range(0), state.range(1), state.range(3), nVars);
+   BoosterHandle xgbooster;
+   safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+   safe_xgboost(XGBoosterSetParam(xgbooster, "max_depth", std::to_string((int) state.range(1)).c_str()))
+   safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", std::to_string((int) state.range(2)).c_str()))
+   safe_xgboost(XGBoosterSetParam(xgbooster, "eta", "0.01"))
+   safe_xgboost(XGBoosterLoadModel(xgbooster, fname.c_str()))
+
    // Benchmarking
-   UInt_t iter_c = 0;
+   perf_recorder perf;
+   thread_scaling scaling(state.range(2));
    for(auto _: state){
-      // Load the trained booster model...
-      string fname = "BDT_" + to_string(state.range(0)) + "_" + to_string(state.range(1)) + ".model";
-      BoosterHandle xgbooster;
-      safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
-      safe_xgboost(XGBoosterSetParam(xgbooster, "max_depth", std::to_string((int) state.range(1)).c_str()))
-      safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", std::to_string((int) state.range(2)).c_str()))
-      safe_xgboost(XGBoosterSetParam(xgbooster, "eta", "0.01"))
-      safe_xgboost(XGBoosterLoadModel(xgbooster, fname.c_str()))
-
+      // Convert the testing data set in each iteration, such that predictions are never served from XGBoost's
+      // prediction cache (which is keyed by DMatrix), untimed as the conversion is not part of the prediction
+      state.PauseTiming();
+      perf.Pause();
+      scaling.Pause();
       xgboost_data* xg_test_data = ROOTToXGBoost(dataloader->GetDefaultDataSetInfo(), TMVA::Types::kTesting);
+      scaling.Resume();
+      perf.Resume();
+      state.ResumeTiming();
 
-      // Get current memory usage statistics after setup
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         init_mem_res = pinfo.fMemResident;
-      }
-
+      allocs.Start();
       // Prepare the necessary data structures and carry out the predictions on the (converted) testing data set...
       bst_ulong output_length;
       const Float_t *output_result;
       safe_xgboost(XGBoosterPredict(xgbooster, (xg_test_data->sb_dmats)[0], 0, 0, &output_length, &output_result))
-
-      // Maintain Memory statistics (independent from Google Benchmark)
-      if(mem_stats && iter_c == 0){
-         gSystem->GetProcInfo(&pinfo);
-         term_mem_res = pinfo.fMemResident;
-         mem_res += (double) (term_mem_res - init_mem_res);
-      }
-
-      iter_c++;
+      allocs.Stop();
 
       // Lastly, free any XGBoost related data structures to prevent memory leaks.
+      state.PauseTiming();
+      perf.Pause();
+      scaling.Pause();
       xg_test_data->free();
-      safe_xgboost(XGBoosterFree(xgbooster));
+      delete xg_test_data;
+      scaling.Resume();
+      perf.Resume();
+      state.ResumeTiming();
    }
+   perf.Report(state);
 
-   if(mem_stats){
-      mem_res *= iter_c;
-      state.counters["Resident Memory"] = benchmark::Counter(mem_res, benchmark::Counter::kAvgIterations);
-   }
+   // Single-thread reference of the speedup, converting the testing data set untimed just as above
+   safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", "1"))
+   scaling.Report(state, [&](){
+      xgboost_data* xg_test_data = ROOTToXGBoost(dataloader->GetDefaultDataSetInfo(), TMVA::Types::kTesting);
+      auto start = chrono::steady_clock::now();
+      bst_ulong output_length;
+      const Float_t *output_result;
+      safe_xgboost(XGBoosterPredict(xgbooster, (xg_test_data->sb_dmats)[0], 0, 0, &output_length, &output_result))
+      chrono::duration<double> time = chrono::steady_clock::now() - start;
+      xg_test_data->free();
+      delete xg_test_data;
+      return time.count();
+   });
+   allocs.Report(state);
+
+   // Testing throughput, in (signal and background) events and feature values per second
+   state.SetItemsProcessed(state.iterations() * 2 * nEvents);
+   state.counters["Feature Values"] = benchmark::Counter(2.0 * nEvents * nVars,
+                                                         benchmark::Counter::kIsIterationInvariantRate);
 
    // Teardown
+   safe_xgboost(XGBoosterFree(xgbooster))
    delete testTree;
    delete trainBKGTree;
 
    outputFile->Close();
    delete outputFile;
 }
-BENCHMARK(BM_XGBOOST_BDTTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}});
+BENCHMARK(BM_XGBOOST_BDTTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16}, {gridEvents},
+                                               {gridVars}});
+BENCHMARK(BM_XGBOOST_BDTTesting)->Apply(BDTScalingArgs);
+BENCHMARK(BM_XGBOOST_BDTTesting)->Apply(ThreadScalingArgs);
+
+static void BM_FlatForest_XGBoostTesting(benchmark::State &state){
+   // Parameters
+   UInt_t nEvents = state.range(3) / 2; // half size, split between signal and background as in BM_XGBOOST_BDTTesting
+   UInt_t nVars = state.range(4);
+
+   // Set up: signal and background test data sets, scored straight from their (column-major) mapped columns
+   random_columns* sigColumns = testColumnsCached(nEvents, nVars);
+   random_columns* bkgColumns = testColumnsCached(nEvents, nVars, false);
+   vector<Float_t> sigScores(nEvents), bkgScores(nEvents);
+
+   // Re-save the booster trained by BM_XGBOOST_BDTTraining in XGBoost's JSON model format, and load the forest from it
+   string fname = xgboostModelFile(state.range(0), state.range(1), state.range(3), nVars);
+   string json = resaveXGBoostModel(fname);
+
+   auto load_start = chrono::steady_clock::now();
+   flat_forest* forest = XGBoostToFlatForest(json);
+   chrono::duration<double> load_time = chrono::steady_clock::now() - load_start;
+
+   // The booster itself is the reference of the predictions of the forest
+   BoosterHandle xgbooster;
+   safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+   safe_xgboost(XGBoosterLoadModel(xgbooster, fname.c_str()))
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      forest->Predict(sigColumns->Column(0), nEvents, 1, nEvents, sigScores.data(), state.range(2));
+      forest->Predict(bkgColumns->Column(0), nEvents, 1, nEvents, bkgScores.data(), state.range(2));
+   }
+   perf.Report(state);
+
+   state.counters["Load Time"] = load_time.count();
+
+   // Largest deviation from the predictions of XGBoost on the same events, which should be down to float rounding only
+   double max_dev = 0.0;
+   for(auto sample: {make_pair(sigColumns, &sigScores), make_pair(bkgColumns, &bkgScores)}){
+      vector<Float_t> rows = sample.first->AsRows();
+
+      DMatrixHandle dmat;
+      bst_ulong output_length;
+      const Float_t *output_result;
+      safe_xgboost(XGDMatrixCreateFromMat(rows.data(), nEvents, nVars, NAN, &dmat))
+      safe_xgboost(XGBoosterPredict(xgbooster, dmat, 0, 0, &output_length, &output_result))
+      for(UInt_t i = 0; i < nEvents; i++){
+         max_dev = max(max_dev, (double) fabs((*sample.second)[i] - output_result[i]));
+      }
+      safe_xgboost(XGDMatrixFree(dmat))
+   }
+   state.counters["Max Deviation"] = max_dev;
+
+   // Testing throughput, in (signal and background) events and feature values per second
+   state.SetItemsProcessed(state.iterations() * 2 * nEvents);
+   state.counters["Feature Values"] = benchmark::Counter(2.0 * nEvents * nVars,
+                                                         benchmark::Counter::kIsIterationInvariantRate);
+
+   // Teardown
+   safe_xgboost(XGBoosterFree(xgbooster))
+   forest->free();
+   delete forest;
+   delete sigColumns;
+   delete bkgColumns;
+}
+BENCHMARK(BM_FlatForest_XGBoostTesting)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {1, 4, 8, 16},
+                                                     {gridEvents}, {gridVars}});
+BENCHMARK(BM_FlatForest_XGBoostTesting)->Apply(BDTScalingArgs);
+
+static void BM_TMVA_ModelLoading(benchmark::State &state){
+   // Load the weights trained (single-threaded, on the grid data set) by BM_TMVA_BDTTraining, as a job would at
+   // start-up
+   string weights = tmvaWeightsFile(state.range(0), state.range(1), 1, gridEvents, gridVars);
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      RReader model(weights);
+   }
+   perf.Report(state);
+
+   state.SetLabel("xml");
+   state.counters["Model Size"] = (double) ifstream(weights, ios::binary | ios::ate).tellg();
+}
+BENCHMARK(BM_TMVA_ModelLoading)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}})
+                               ->Unit(benchmark::kMillisecond);
+
+/* Loading of the TMVA weights of BM_TMVA_ModelLoading by RReader (0), into a flat forest (1), and by mapping the flat
+ * forest file converted from them (2), with the resident memory held by the loaded model before and after scoring a
+ * batch of events with it.
+ */
+static void BM_TMVA_BinaryModelLoading(benchmark::State &state){
+   // Parameters
+   UInt_t nEvents = 10000;
+   UInt_t nVars = gridVars;
+   Int_t engine = state.range(2);
+   const char* engineNames[] = {"RReader", "flat forest", "mapped flat forest"};
+   state.SetLabel(engineNames[engine]);
+
+   // Set up: convert the weights to a flat forest file next to them
+   string weights = tmvaWeightsFile(state.range(0), state.range(1), 1, gridEvents, nVars);
+   string forestFile = weights.substr(0, weights.size() - string(".weights.xml").size()) + ".forest";
+   TMVAToFlatForestFile(weights, forestFile);
+
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   auto testTensor = testColumns->AsTensor();
+   vector<Float_t> scores(nEvents);
+
+   RReader* model = nullptr;
+   flat_forest* forest = nullptr;
+   auto load = [&](){
+      if(engine == 0){
+         model = new RReader(weights);
+      }else{
+         forest = (engine == 1) ? TMVAToFlatForest(weights) : MapFlatForest(forestFile);
+      }
+   };
+   auto unload = [&](){
+      delete model;
+      model = nullptr;
+      if(forest){ forest->free(); }
+      delete forest;
+      forest = nullptr;
+   };
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      load();
+      unload();
+   }
+   perf.Report(state);
+
+   // Resident memory of a loaded model, which for a mapped forest grows as scoring touches its pages
+   ProcInfo_t pinfo;
+   gSystem->GetProcInfo(&pinfo);
+   Long_t init_mem_res = pinfo.fMemResident;
+   load();
+   gSystem->GetProcInfo(&pinfo);
+   Long_t load_mem_res = pinfo.fMemResident;
+   if(model){
+      auto out = model->Compute(testTensor);
+      copy(out.GetData(), out.GetData() + nEvents, scores.begin());
+   }else{
+      forest->Predict(testColumns->Column(0), nEvents, 1, nEvents, scores.data());
+   }
+   gSystem->GetProcInfo(&pinfo);
+   state.counters["Resident Memory"] = (double) (load_mem_res - init_mem_res);
+   state.counters["Resident Memory after Scoring"] = (double) (pinfo.fMemResident - init_mem_res);
+   unload();
+
+   // Largest deviation from the scores of RReader, which should be down to float rounding only
+   if(engine != 0){
+      RReader reference(weights);
+      auto out = reference.Compute(testTensor);
+      double max_dev = 0.0;
+      for(UInt_t i = 0; i < nEvents; i++){ max_dev = max(max_dev, (double) fabs(scores[i] - out.GetData()[i])); }
+      state.counters["Max Deviation"] = max_dev;
+   }
+
+   state.counters["Model Size"] = (double) ifstream(engine == 2 ? forestFile : weights, ios::binary | ios::ate).tellg();
+
+   // Teardown
+   delete testColumns;
+}
+BENCHMARK(BM_TMVA_BinaryModelLoading)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {0, 1, 2}})
+                                     ->Unit(benchmark::kMillisecond);
+
+static void BM_XGBOOST_ModelLoading(benchmark::State &state){
+   // Parameters
+   xgboost_model_format format = (xgboost_model_format) state.range(2);
+   Bool_t from_buffer = state.range(3);
+
+   state.SetLabel(string(xgboost_model_format_name(format)) + (from_buffer ? "/buffer" : "/file"));
+   if(!xgboost_model_format_supported(format)){
+      state.SkipWithError("Model format not supported by this XGBoost version");
+      return;
+   }
+
+   // Set up: re-save the booster trained (on the grid data set) by BM_XGBOOST_BDTTraining in the requested format
+   string path = resaveXGBoostModel(xgboostModelFile(state.range(0), state.range(1), gridEvents, gridVars), format);
+
+   // Loading from a buffer leaves out the file system, as when the model is embedded or shipped with the job
+   string buffer = xgboost_read_file(path);
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      BoosterHandle loaded;
+      safe_xgboost(XGBoosterCreate(0, 0, &loaded))
+      if(from_buffer){
+         safe_xgboost(XGBoosterLoadModelFromBuffer(loaded, buffer.data(), buffer.size()))
+      }else{
+         safe_xgboost(XGBoosterLoadModel(loaded, path.c_str()))
+      }
+      safe_xgboost(XGBoosterFree(loaded))
+   }
+   perf.Report(state);
+
+   state.counters["Model Size"] = buffer.size();
+}
+BENCHMARK(BM_XGBOOST_ModelLoading)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2},
+                                                 {kModelBinary, kModelJSON, kModelUBJSON}, {0, 1}})
+                                  ->Unit(benchmark::kMillisecond);
+
+// Loads the forest trained (single-threaded, on the grid data set) by BM_TMVA_BDTTraining or BM_XGBOOST_BDTTraining.
+static flat_forest* loadTrainedFlatForest(bool xgboost, int64_t nTrees, int64_t maxDepth){
+   if(!xgboost){
+      return TMVAToFlatForest(tmvaWeightsFile(nTrees, maxDepth, 1, gridEvents, gridVars));
+   }
+
+   return loadXGBoostFlatForest(xgboostModelFile(nTrees, maxDepth, gridEvents, gridVars));
+}
+
+static void BM_FlatForest_Kernels(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 100000;
+   flat_forest_kernel kernel = (flat_forest_kernel) state.range(2);
+   Bool_t xgboost = state.range(3);
+
+   if(!flat_forest_kernel_supported(kernel)){
+      state.SkipWithError("Kernel not supported on this machine");
+      return;
+   }
+
+   // Set up: a row-major copy of the test data set, such that the kernels gather straight from the input
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   vector<Float_t> rows = testColumns->AsRows();
+   vector<Float_t> scores(nEvents);
+
+   flat_forest* forest = loadTrainedFlatForest(xgboost, state.range(0), state.range(1));
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      flat_forest_predict(*forest, rows.data(), nEvents, nVars, 1, scores.data(), kernel);
+   }
+   perf.Report(state);
+
+   // Scoring throughput, in events and (event, tree) pairs per second
+   state.SetLabel(string(flat_forest_kernel_name(kernel)) + (xgboost ? "/XGBoost" : "/TMVA"));
+   state.SetItemsProcessed(state.iterations() * nEvents);
+   state.counters["Tree Traversals"] = benchmark::Counter(1.0 * nEvents * forest->n_trees,
+                                                          benchmark::Counter::kIsIterationInvariantRate);
+
+   // Teardown
+   forest->free();
+   delete forest;
+   delete testColumns;
+}
+BENCHMARK(BM_FlatForest_Kernels)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2},
+                                              {kForestScalar, kForestAVX2, kForestAVX512}, {0, 1}});
+
+static void BM_QuickScorer_Testing(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 100000;
+   Int_t engine = state.range(2); // 0: QuickScorer, 1: RReader (TMVA model); 2: QuickScorer, 3: XGBoost (XGBoost model)
+   Bool_t xgboost = (engine >= 2);
+
+   // Set up: the test data set, both as (column-major) tensor and as row-major copy
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   auto testTensor = testColumns->AsTensor();
+   vector<Float_t> rows = testColumns->AsRows();
+   vector<Float_t> scores(nEvents);
+
+   // All engines score the same trained model, loaded ahead of the benchmarking loop
+   flat_forest* forest = loadTrainedFlatForest(xgboost, state.range(0), state.range(1));
+   quickscorer_forest* qs = FlatForestToQuickScorer(*forest);
+
+   Int_t nTrees = state.range(0), maxDepth = state.range(1);
+   RReader* model = nullptr;
+   BoosterHandle xgbooster = nullptr;
+   if(engine == 1){
+      model = new RReader(tmvaWeightsFile(nTrees, maxDepth, 1, gridEvents, nVars));
+   }else if(engine == 3){
+      safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+      safe_xgboost(XGBoosterLoadModel(xgbooster, xgboostModelFile(nTrees, maxDepth, gridEvents, nVars).c_str()))
+      safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", "1"))
+   }
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      if(engine == 1){
+         auto out = model->Compute(testTensor);
+         benchmark::DoNotOptimize(out.GetData());
+      }else if(engine == 3){
+         // A fresh DMatrix, such that predictions are never served from XGBoost's prediction cache, built untimed
+         state.PauseTiming();
+         perf.Pause();
+         DMatrixHandle dmat;
+         safe_xgboost(XGDMatrixCreateFromMat(rows.data(), nEvents, nVars, NAN, &dmat))
+         perf.Resume();
+         state.ResumeTiming();
+
+         bst_ulong output_length;
+         const Float_t *output_result;
+         safe_xgboost(XGBoosterPredict(xgbooster, dmat, 0, 0, &output_length, &output_result))
+         benchmark::DoNotOptimize(output_result);
+
+         state.PauseTiming();
+         perf.Pause();
+         safe_xgboost(XGDMatrixFree(dmat))
+         perf.Resume();
+         state.ResumeTiming();
+      }else{
+         qs->Predict(rows.data(), nEvents, nVars, 1, scores.data());
+      }
+   }
+   perf.Report(state);
+
+   const char* engines[] = {"QuickScorer/TMVA", "RReader", "QuickScorer/XGBoost", "XGBoost"};
+   state.SetLabel(engines[engine]);
+   state.counters["Bitvector Words"] = qs->n_words;
+
+   // Scoring throughput, in events per second
+   state.SetItemsProcessed(state.iterations() * nEvents);
+
+   // Teardown
+   delete model;
+   if(xgbooster){
+      safe_xgboost(XGBoosterFree(xgbooster))
+   }
+   delete qs;
+   forest->free();
+   delete forest;
+   delete testColumns;
+}
+BENCHMARK(BM_QuickScorer_Testing)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {0, 1, 2, 3}});
+
+static void BM_Codegen_Testing(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 100000;
+   Bool_t xgboost = state.range(2);
+
+   // Set up: a row-major copy of the test data set
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   vector<Float_t> rows = testColumns->AsRows();
+   vector<Float_t> scores(nEvents);
+
+   // Compile the trained model into a shared library
+   flat_forest* forest = loadTrainedFlatForest(xgboost, state.range(0), state.range(1));
+   string prefix = string("bdt_codegen_") + (xgboost ? "xgb_" : "tmva_") + to_string(state.range(0)) + "_" +
+                   to_string(state.range(1));
+   compiled_forest* compiled = CompileForest(*forest, prefix);
+
+   // Per-event time of the interpreted (flat forest) model, to weigh the compilation time against
+   auto interp_start = chrono::steady_clock::now();
+   forest->Predict(rows.data(), nEvents, nVars, 1, scores.data());
+   chrono::duration<double> interp_time = chrono::steady_clock::now() - interp_start;
+
+   // Benchmarking
+   perf_recorder perf;
+   auto start = chrono::steady_clock::now();
+   for(auto _: state){
+      compiled->Predict(rows.data(), nEvents, nVars, 1, scores.data());
+   }
+   chrono::duration<double> time = chrono::steady_clock::now() - start;
+   perf.Report(state);
+
+   // Number of events after which compiling pays off against interpreting, or -1 if the compiled model is not faster
+   double event_time = time.count() / (state.iterations() * (double) nEvents);
+   double interp_event_time = interp_time.count() / nEvents;
+   double break_even = (interp_event_time > event_time) ? compiled->compile_time / (interp_event_time - event_time) : -1;
+
+   state.SetLabel(xgboost ? "XGBoost" : "TMVA");
+   state.counters["Source Size"] = compiled->source_size;
+   state.counters["Library Size"] = compiled->library_size;
+   state.counters["Codegen Time"] = compiled->codegen_time;
+   state.counters["Compile Time"] = compiled->compile_time;
+   state.counters["Time per Event"] = event_time;
+   state.counters["Interpreted Time per Event"] = interp_event_time;
+   state.counters["Break-even Events"] = break_even;
+   state.SetItemsProcessed(state.iterations() * nEvents);
+
+   // Teardown
+   compiled->free();
+   delete compiled;
+   forest->free();
+   delete forest;
+   delete testColumns;
+}
+BENCHMARK(BM_Codegen_Testing)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {0, 1}})
+   ->Unit(benchmark::kMillisecond);
+
+static void BM_JIT_Testing(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 100000;
+   Bool_t xgboost = state.range(2);
+
+   // Set up: a row-major copy of the test data set
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   vector<Float_t> rows = testColumns->AsRows();
+   vector<Float_t> scores(nEvents);
+
+   // JIT-compile the trained model with Cling (once per process, later runs reusing the function and the JIT time of
+   // the first one); the latency up to the first scored event is reported separately from the steady-state scoring
+   flat_forest* forest = loadTrainedFlatForest(xgboost, state.range(0), state.range(1));
+   compiled_forest* jitted = JITForest(*forest);
+
+   auto first_call_start = chrono::steady_clock::now();
+   jitted->Predict(rows.data(), 1, nVars, 1, scores.data());
+   chrono::duration<double> first_call_time = chrono::steady_clock::now() - first_call_start;
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      jitted->Predict(rows.data(), nEvents, nVars, 1, scores.data());
+   }
+   perf.Report(state);
+
+   state.SetLabel(xgboost ? "XGBoost" : "TMVA");
+   state.counters["Source Size"] = jitted->source_size;
+   state.counters["Codegen Time"] = jitted->codegen_time;
+   state.counters["JIT Time"] = jitted->compile_time;
+   state.counters["First Call Time"] = first_call_time.count();
+   state.counters["Time per Event"] = benchmark::Counter(nEvents, benchmark::Counter::kIsIterationInvariantRate |
+                                                                   benchmark::Counter::kInvert);
+   state.SetItemsProcessed(state.iterations() * nEvents);
+
+   // Teardown (the JIT-compiled code stays in the interpreter, for the later runs of the same model)
+   delete jitted;
+   forest->free();
+   delete forest;
+   delete testColumns;
+}
+BENCHMARK(BM_JIT_Testing)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {0, 1}})
+   ->Unit(benchmark::kMillisecond);
+
+static void BM_SameModel_Testing(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 100000;
+   Bool_t xgboost = state.range(2); // framework the model was trained with, the other one scoring its conversion
+   Int_t engine = state.range(3);   // 0: RReader, 1: XGBoost, 2: flat forest, 3: QuickScorer
+   const char* engineNames[] = {"RReader", "XGBoost", "flat forest", "QuickScorer"};
+   state.SetLabel(string(engineNames[engine]) + (xgboost ? "/XGBoost model" : "/TMVA model"));
+
+   // Set up: the test data set, both as (column-major) tensor and as row-major copy
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   auto testTensor = testColumns->AsTensor();
+   vector<Float_t> rows = testColumns->AsRows();
+   vector<Float_t> scores(nEvents), reference(nEvents);
+
+   // Convert the trained model into the format of the other framework, such that all engines score the same forest
+   string key = to_string(state.range(0)) + "_" + to_string(state.range(1)) + "_" + to_string(nVars);
+   string tmvaWeights = xgboost ? "bdt_converted_xgb_" + key + ".weights.xml"
+                                : tmvaWeightsFile(state.range(0), state.range(1), 1, gridEvents, nVars);
+   string xgbModel = xgboost ? xgboostModelFile(state.range(0), state.range(1), gridEvents, nVars)
+                             : "bdt_converted_tmva_" + key + ".json";
+
+   flat_forest* forest = loadTrainedFlatForest(xgboost, state.range(0), state.range(1));
+   auto conversion_start = chrono::steady_clock::now();
+   if(xgboost){
+      WriteTMVAWeights(*forest, tmvaWeights);
+   }else{
+      WriteXGBoostJSON(*forest, xgbModel);
+   }
+   chrono::duration<double> conversion_time = chrono::steady_clock::now() - conversion_start;
+   flat_forest* converted = xgboost ? TMVAToFlatForest(tmvaWeights) : XGBoostToFlatForest(xgbModel);
+
+   // Outputs are compared on the scale shared by the forest and its conversion (see ForestConvert.h)
+   flat_forest_transform engineTransforms[] = {(xgboost ? converted : forest)->transform,
+                                               (xgboost ? forest : converted)->transform, forest->transform,
+                                               forest->transform};
+   forest->Predict(rows.data(), nEvents, nVars, 1, reference.data());
+
+   RReader* model = nullptr;
+   BoosterHandle xgbooster = nullptr;
+   quickscorer_forest* qs = nullptr;
+   if(engine == 0){
+      model = new RReader(tmvaWeights);
+   }else if(engine == 1){
+      safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+      safe_xgboost(XGBoosterLoadModel(xgbooster, xgbModel.c_str()))
+      safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", "1"))
+   }else if(engine == 3){
+      qs = FlatForestToQuickScorer(*forest);
+   }
+
+   // Benchmarking
+   perf_recorder perf;
+   auto score = [&](){
+      if(engine == 0){
+         auto out = model->Compute(testTensor);
+         copy(out.GetData(), out.GetData() + nEvents, scores.begin());
+      }else if(engine == 1){
+         // A fresh DMatrix, such that predictions are never served from XGBoost's prediction cache, built untimed
+         state.PauseTiming();
+         perf.Pause();
+         DMatrixHandle dmat;
+         safe_xgboost(XGDMatrixCreateFromMat(rows.data(), nEvents, nVars, NAN, &dmat))
+         perf.Resume();
+         state.ResumeTiming();
+
+         bst_ulong output_length;
+         const Float_t *output_result;
+         safe_xgboost(XGBoosterPredict(xgbooster, dmat, 0, 0, &output_length, &output_result))
+         copy(output_result, output_result + nEvents, scores.begin());
+
+         state.PauseTiming();
+         perf.Pause();
+         safe_xgboost(XGDMatrixFree(dmat))
+         perf.Resume();
+         state.ResumeTiming();
+      }else if(engine == 2){
+         forest->Predict(rows.data(), nEvents, nVars, 1, scores.data());
+      }else{
+         qs->Predict(rows.data(), nEvents, nVars, 1, scores.data());
+      }
+   };
+
+   for(auto _: state){
+      score();
+   }
+   perf.Report(state);
+
+   // Largest deviation from the flat forest of the trained model, which should be down to float rounding only
+   double max_dev = 0.0;
+   for(UInt_t i = 0; i < nEvents; i++){
+      max_dev = max(max_dev, fabs(forest_common_output(engineTransforms[engine], scores[i]) -
+                                  forest_common_output(forest->transform, reference[i])));
+   }
+   state.counters["Max Deviation"] = max_dev;
+   state.counters["Conversion Time"] = conversion_time.count();
+
+   // Scoring throughput, in events and (event, tree) pairs per second
+   state.SetItemsProcessed(state.iterations() * nEvents);
+   state.counters["Tree Traversals"] = benchmark::Counter(1.0 * nEvents * forest->n_trees,
+                                                          benchmark::Counter::kIsIterationInvariantRate);
+
+   // Teardown
+   delete model;
+   if(xgbooster){ safe_xgboost(XGBoosterFree(xgbooster)) }
+   delete qs;
+   converted->free();
+   delete converted;
+   forest->free();
+   delete forest;
+   delete testColumns;
+}
+BENCHMARK(BM_SameModel_Testing)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {0, 1}, {0, 1, 2, 3}})
+                               ->Unit(benchmark::kMillisecond);
+
+static void BM_SingleEvent_Latency(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 10000;
+   Int_t engine = state.range(2);
+   Bool_t xgboost = (engine >= 3);
+
+   // Set up: row-major copy of the test data set, whose events are scored one at a time (cycling through them)
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   vector<Float_t> rows = testColumns->AsRows();
+
+   // Engines, all set up on the same trained model: RReader, the flat forest and QuickScorer for TMVA models (0-2), and
+   // in-place prediction, the flat forest and QuickScorer for XGBoost models (3-5)
+   Int_t nTrees = state.range(0), maxDepth = state.range(1);
+   flat_forest* forest = loadTrainedFlatForest(xgboost, state.range(0), state.range(1));
+   quickscorer_forest* qs = FlatForestToQuickScorer(*forest);
+   vector<ULong64_t> qs_words(qs->n_words);
+
+   RReader* model = nullptr;
+   BoosterHandle xgbooster = nullptr;
+   if(engine == 0){
+      model = new RReader(tmvaWeightsFile(nTrees, maxDepth, 1, gridEvents, nVars));
+   }else if(engine == 3){
+      safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+      safe_xgboost(XGBoosterLoadModel(xgbooster, xgboostModelFile(nTrees, maxDepth, gridEvents, nVars).c_str()))
+      safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", "1"))
+   }
+
+   latency_recorder latencies;
+   latencies.Reserve(state.max_iterations);
+   vector<Float_t> event(nVars);
+
+   // Benchmarking
+   UInt_t i = 0;
+   perf_recorder perf;
+   for(auto _: state){
+      const Float_t* x = rows.data() + (size_t) i * nVars;
+      auto start = latencies.Start();
+      switch(engine){
+         case 0:{
+            event.assign(x, x + nVars);
+            auto out = model->Compute(event);
+            benchmark::DoNotOptimize(out.data());
+            break;
+         }
+         case 3:
+            benchmark::DoNotOptimize(xgboost_predict_dense(xgbooster, x, 1, nVars));
+            break;
+         case 2:
+         case 5:
+            benchmark::DoNotOptimize(qs->Predict(x, 1, qs_words.data()));
+            break;
+         default:
+            benchmark::DoNotOptimize(forest->Predict(x));
+      }
+      latencies.Stop(start);
+
+      i = (i + 1) % nEvents;
+   }
+   perf.Report(state);
+
+   const char* engines[] = {"RReader", "FlatForest/TMVA", "QuickScorer/TMVA", "XGBoost in-place",
+                            "FlatForest/XGBoost", "QuickScorer/XGBoost"};
+   state.SetLabel(engines[engine]);
+   latencies.Report(state);
+   state.SetItemsProcessed(state.iterations());
+
+   // Teardown
+   delete model;
+   if(xgbooster){
+      safe_xgboost(XGBoosterFree(xgbooster))
+   }
+   delete qs;
+   forest->free();
+   delete forest;
+   delete testColumns;
+}
+BENCHMARK(BM_SingleEvent_Latency)->ArgsProduct({{2000, 1000, 400, 100}, {10, 8, 6, 4, 2}, {0, 1, 2, 3, 4, 5}});
+
+static void BM_Inference_BatchSize(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = gridVars;
+   UInt_t nEvents = 65536;
+   Long64_t batchSize = state.range(0);
+   Int_t engine = state.range(1); // 0: RReader, 1: XGBoosterPredict, 2: XGBoost in-place, 3: flat forest (XGBoost)
+   Int_t nTrees = 400, maxDepth = 6;
+
+   // Set up: row-major copy of the test data set, which each iteration scores in batches of batchSize events
+   random_columns* testColumns = testColumnsCached(nEvents, nVars);
+   vector<Float_t> rows = testColumns->AsRows();
+   vector<Float_t> scores(nEvents);
+
+   RReader* model = nullptr;
+   BoosterHandle xgbooster = nullptr;
+   flat_forest* forest = nullptr;
+   if(engine == 0){
+      model = new RReader(tmvaWeightsFile(nTrees, maxDepth, 1, gridEvents, nVars));
+   }else if(engine == 3){
+      forest = loadTrainedFlatForest(true, nTrees, maxDepth);
+   }else{
+      safe_xgboost(XGBoosterCreate(0, 0, &xgbooster))
+      safe_xgboost(XGBoosterLoadModel(xgbooster, xgboostModelFile(nTrees, maxDepth, gridEvents, nVars).c_str()))
+      safe_xgboost(XGBoosterSetParam(xgbooster, "nthread", "1"))
+   }
+
+   // Scores the events [begin, begin + n) as one batch
+   auto score_batch = [&](Long64_t begin, Long64_t n){
+      Float_t* batch = rows.data() + begin * nVars;
+      switch(engine){
+         case 0:{
+            RTensor<Float_t> x(batch, {(size_t) n, nVars});
+            auto out = model->Compute(x);
+            benchmark::DoNotOptimize(out.GetData());
+            break;
+         }
+         case 1:{
+            DMatrixHandle dmat;
+            bst_ulong output_length;
+            const Float_t *output_result;
+            safe_xgboost(XGDMatrixCreateFromMat(batch, n, nVars, NAN, &dmat))
+            safe_xgboost(XGBoosterPredict(xgbooster, dmat, 0, 0, &output_length, &output_result))
+            benchmark::DoNotOptimize(output_result);
+            safe_xgboost(XGDMatrixFree(dmat))
+            break;
+         }
+         case 2:
+            benchmark::DoNotOptimize(xgboost_predict_dense(xgbooster, batch, n, nVars));
+            break;
+         default:
+            forest->Predict(batch, n, nVars, 1, scores.data() + begin);
+      }
+   };
+
+   // Asymptotic per-event cost, from scoring all the events as a single batch
+   score_batch(0, nEvents);
+   auto bulk_start = chrono::steady_clock::now();
+   score_batch(0, nEvents);
+   chrono::duration<double> bulk_time = chrono::steady_clock::now() - bulk_start;
+
+   // Benchmarking
+   auto start = chrono::steady_clock::now();
+   perf_recorder perf;
+   for(auto _: state){
+      for(Long64_t begin = 0; begin < nEvents; begin += batchSize){
+         score_batch(begin, min<Long64_t>(batchSize, nEvents - begin));
+      }
+   }
+   perf.Report(state);
+   chrono::duration<double> time = chrono::steady_clock::now() - start;
+
+   // Fixed overhead per batch, i.e. the time per batch in excess of the asymptotic cost of its events
+   double n_batches = state.iterations() * (double) ((nEvents + batchSize - 1) / batchSize);
+   double batch_time = time.count() / n_batches;
+   double event_time = bulk_time.count() / nEvents;
+
+   const char* engines[] = {"RReader", "XGBoosterPredict", "XGBoost in-place", "FlatForest"};
+   state.SetLabel(engines[engine]);
+   state.counters["Time per Batch"] = batch_time;
+   state.counters["Per-batch Overhead"] = batch_time - min<Long64_t>(batchSize, nEvents) * event_time;
+   state.SetItemsProcessed(state.iterations() * nEvents);
+
+   // Teardown
+   delete model;
+   if(xgbooster){
+      safe_xgboost(XGBoosterFree(xgbooster))
+   }
+   if(forest){
+      forest->free();
+      delete forest;
+   }
+   delete testColumns;
+}
+BENCHMARK(BM_Inference_BatchSize)->ArgsProduct({{1, 8, 64, 512, 4096, 65536}, {0, 1, 2, 3}})
+   ->Unit(benchmark::kMillisecond);
+
+static void BM_ROOTToXGBoost_TTree(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = state.range(0);
+   UInt_t nEvents = 100000;
+   Bool_t single_pass = state.range(1);
+
+   // Set up: the signal and background trees are written to file, which is then reopened read-only, such that the
+   // conversion reads them back from disk
+   const char* inputFileName = "bdt_xgb_bench_conv_input.root";
+   auto outputFile = new TFile(inputFileName, "RECREATE");
+   genTreeCached("sigTree", nEvents, nVars,0.3, 0.5, 100);
+   genTreeCached("bkgTree", nEvents, nVars,-0.3, 0.5, 101);
+   TFile* inputFile = reopenReadOnly(outputFile, inputFileName);
+   TTree *sigTree = inputFile->Get<TTree>("sigTree");
+   TTree *bkgTree = inputFile->Get<TTree>("bkgTree");
+
+   // Variables to extract, using naming convention for randomly generated TTrees in MakeRandomTTree.h
+   vector<string> variables;
+   for(UInt_t i = 0; i < nVars; i++){
+      variables.push_back("var" + to_string(i));
+   }
+
+   ROOT::EnableImplicitMT(state.range(2));
+
+   // Check that the single event loop fills the rows in the order of the entries of the trees, as a serial read does,
+   // also when it is multi-threaded
+   if(single_pass){
+      ULong64_t mismatches = xgboost_row_order_mismatches(*sigTree, variables) +
+                             xgboost_row_order_mismatches(*bkgTree, variables);
+      if(mismatches != 0){
+         state.SkipWithError("Rows of the single-pass conversion are not in the order of the tree entries");
+      }
+   }
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      xgboost_data* xg_data = ROOTToXGBoost(*sigTree, *bkgTree, variables, nullptr, nullptr, single_pass);
+
+      xg_data->free();
+      delete xg_data;
+   }
+   perf.Report(state);
+
+   // Conversion throughput, in (signal and background) events per second
+   state.SetItemsProcessed(state.iterations() * 2 * nEvents);
+
+   // Teardown (the trees are owned by the file)
+   ROOT::DisableImplicitMT();
+
+   inputFile->Close();
+   delete inputFile;
+}
+BENCHMARK(BM_ROOTToXGBoost_TTree)->ArgsProduct({{4, 16, 64, 256}, {0, 1}, {1, 4}});
+
+static void BM_ROOTToXGBoost_DataSet(benchmark::State &state){
+   // Parameters
+   UInt_t nEvents = state.range(0);
+   UInt_t nVars = state.range(1);
+   xgboost_fill_mode fill_mode = (state.range(2) == 0) ? kFillPerCell : kFillBlocked;
+
+   // Set up
+   TTree *sigTree = genTreeCached("sigTree", nEvents, nVars,0.3, 0.5, 100);
+   TTree *bkgTree = genTreeCached("bkgTree", nEvents, nVars,-0.3, 0.5, 101);
+
+   // Prepare a DataLoader instance, registering the signal and background TTrees
+   auto *dataloader = new TMVA::DataLoader("bdt_xgb_bench_conv");
+   dataloader->AddSignalTree(sigTree);
+   dataloader->AddBackgroundTree(bkgTree);
+
+   // Register variables in dataloader, using naming convention for randomly generated TTrees in MakeRandomTTree.h
+   for(UInt_t i = 0; i < nVars; i++){
+      string var_name = "var" + to_string(i);
+      dataloader->AddVariable(var_name.c_str(), 'D');
+   }
+
+   dataloader->PrepareTrainingAndTestTree("",
+                  Form("SplitMode=Block:nTrain_Signal=%i:nTrain_Background=%i:!V", nEvents, nEvents));
+
+   // Build the DataSet, which TMVA does lazily on first access, outside of the timed region
+   dataloader->GetDefaultDataSetInfo().GetDataSet();
+
+   ROOT::EnableImplicitMT(state.range(3));
+   ROOT::TThreadExecutor pool(state.range(3)); // shared by the conversions of all iterations
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      xgboost_data* xg_data = ROOTToXGBoost(dataloader->GetDefaultDataSetInfo(), TMVA::Types::kTraining, fill_mode,
+                                            &pool);
+
+      xg_data->free();
+      delete xg_data;
+   }
+   perf.Report(state);
+
+   // Conversion throughput, in (signal and background) events per second
+   state.SetItemsProcessed(state.iterations() * 2 * nEvents);
+
+   // Teardown
+   ROOT::DisableImplicitMT();
+
+   delete dataloader;
+   delete sigTree;
+   delete bkgTree;
+}
+BENCHMARK(BM_ROOTToXGBoost_DataSet)->ArgsProduct({{10000, 100000}, {4, 32, 128}, {0, 1}, {1, 4}});
+
+// Thread budgets of the pipeline benchmark, from two threads (one per pool) up to all hardware threads of the machine
+static void PipelineArgs(benchmark::internal::Benchmark* b){
+   vector<int64_t> threads;
+   for(int64_t n: thread_sweep()){ if(n >= 2){ threads.push_back(n); } }
+   if(threads.empty()){ threads.push_back(2); }
+   b->ArgsProduct({threads});
+}
+
+/* Pipeline in which an RDataFrame conversion (ROOT implicit multi-threading) runs concurrently with XGBoost training
+ * and prediction (XGBoost's OpenMP pool), as when a data frame keeps feeding a running trainer. Each iteration runs the
+ * pipeline twice: with each pool given the whole thread budget, as the other benchmarks configure them, and with the
+ * budget shared between them (see split_thread_budget), such that the gain of the shared budget is measured within
+ * the same run, under the same conditions.
+ *
+ * Both stages are first run on their own with the settings of each budget, such that the slowdown each suffers from
+ * running concurrently measures the contention.
+ */
+static void BM_Pipeline_Concurrent(benchmark::State &state){
+   // Parameters
+   UInt_t nEvents = 100000;
+   UInt_t nVars = 16;
+   UInt_t nRounds = 50;
+   UInt_t nThreads = state.range(0);
+
+   // The budget is the number of hardware threads the pipeline is confined to (see ThreadScaling.h)
+   bool pinned = (nThreads <= get_cpu_topology().NLogical()) &&
+                 set_process_affinity(get_cpu_topology().CPUSet(nThreads));
+
+   // Set up: the trees fed to the conversion, and the training and test data sets of the booster (converted
+   // beforehand), with the trees being written to file and read back from it
+   const char* inputFileName = "bdt_xgb_bench_pipeline_input.root";
+   auto outputFile = new TFile(inputFileName, "RECREATE");
+   genTreeCached("sigTree", nEvents, nVars, 0.3, 0.5, 100);
+   genTreeCached("bkgTree", nEvents, nVars, -0.3, 0.5, 101);
+   genTreeCached("testSigTree", nEvents, nVars, 0.3, 0.5, 102);
+   genTreeCached("testBkgTree", nEvents, nVars, -0.3, 0.5, 103);
+   TFile* inputFile = reopenReadOnly(outputFile, inputFileName);
+   TTree *sigTree = inputFile->Get<TTree>("sigTree");
+   TTree *bkgTree = inputFile->Get<TTree>("bkgTree");
+
+   vector<string> variables;
+   for(UInt_t i = 0; i < nVars; i++){
+      variables.push_back("var" + to_string(i));
+   }
+
+   xgboost_data* xg_train_data = ROOTToXGBoost(*sigTree, *bkgTree, variables, nullptr, nullptr);
+   xgboost_data* xg_test_data = ROOTToXGBoost(*inputFile->Get<TTree>("testSigTree"),
+                                              *inputFile->Get<TTree>("testBkgTree"), variables, nullptr, nullptr);
+
+   // The two stages of the pipeline, each returning its wall time in seconds
+   auto convert = [&](){
+      auto start = chrono::steady_clock::now();
+      xgboost_data* xg_data = ROOTToXGBoost(*sigTree, *bkgTree, variables, nullptr, nullptr);
+      chrono::duration<double> time = chrono::steady_clock::now() - start;
+      xg_data->free();
+      delete xg_data;
+      return time.count();
+   };
+   auto train = [&](const thread_budget& budget){
+      string nthread = to_string(budget.xgboost_threads);
+      xgbooster_opts opts;
+      opts.push_back(kv_pair("max_depth", "6"));
+      opts.push_back(kv_pair("nthread", nthread.c_str()));
+      opts.push_back(kv_pair("eta", "0.01"));
+
+      auto start = chrono::steady_clock::now();
+      BoosterHandle xgbooster = xgboost_train(xg_train_data, &opts, nRounds);
+
+      // Predictions are made on the test data set, as the ones on the training data set are served from the booster's
+      // prediction cache
+      bst_ulong output_length;
+      const Float_t *output_result;
+      safe_xgboost(XGBoosterPredict(xgbooster, (xg_test_data->sb_dmats)[0], 0, 0, &output_length, &output_result))
+      chrono::duration<double> time = chrono::steady_clock::now() - start;
+      safe_xgboost(XGBoosterFree(xgbooster))
+      return time.count();
+   };
+
+   // Times of the pipeline under each budget, summed over the iterations
+   typedef struct pipeline_times{
+      const char* name;
+      thread_budget budget;
+      double solo_conv = 0.0, solo_train = 0.0, conv = 0.0, train = 0.0, pipeline = 0.0;
+   } pipeline_times;
+   pipeline_times budgets[] = {{"Independent", split_thread_budget(nThreads, kBudgetIndependent)},
+                               {"Shared", split_thread_budget(nThreads, kBudgetShared)}};
+
+   for(auto& b: budgets){
+      ROOT::EnableImplicitMT(b.budget.imt_threads);
+      b.solo_conv = convert();
+      b.solo_train = train(b.budget);
+      ROOT::DisableImplicitMT();
+   }
+
+   // Benchmarking, the size of the implicit multi-threading pool being changed untimed in between the budgets
+   perf_recorder perf;
+   for(auto _: state){
+      for(auto& b: budgets){
+         state.PauseTiming();
+         perf.Pause();
+         ROOT::EnableImplicitMT(b.budget.imt_threads);
+         perf.Resume();
+         state.ResumeTiming();
+
+         auto start = chrono::steady_clock::now();
+         thread converter([&](){ b.conv += convert(); });
+         b.train += train(b.budget);
+         converter.join();
+         chrono::duration<double> time = chrono::steady_clock::now() - start;
+         b.pipeline += time.count();
+
+         state.PauseTiming();
+         perf.Pause();
+         ROOT::DisableImplicitMT();
+         perf.Resume();
+         state.ResumeTiming();
+      }
+   }
+   perf.Report(state);
+
+   state.counters["Pinned CPUs"] = pinned ? nThreads : 0;
+   for(auto& b: budgets){
+      const string name = b.name;
+      state.counters[name + " IMT Threads"] = b.budget.imt_threads;
+      state.counters[name + " XGBoost Threads"] = b.budget.xgboost_threads;
+      state.counters[name + " Pipeline Time"] = benchmark::Counter(b.pipeline, benchmark::Counter::kAvgIterations);
+      state.counters[name + " Conversion Slowdown"] = b.conv / state.iterations() / b.solo_conv;
+      state.counters[name + " Training Slowdown"] = b.train / state.iterations() / b.solo_train;
+   }
+   state.counters["Shared Budget Gain"] = budgets[0].pipeline / budgets[1].pipeline;
+
+   // Pipeline throughput, in (signal and background) events converted per second, under both budgets
+   state.SetItemsProcessed(state.iterations() * 2 * 2 * nEvents);
+
+   // Teardown (the trees are owned by the file)
+   if(pinned){ set_process_affinity(get_cpu_topology().cpus); }
+
+   xg_train_data->free();
+   delete xg_train_data;
+   xg_test_data->free();
+   delete xg_test_data;
+
+   inputFile->Close();
+   delete inputFile;
+}
+BENCHMARK(BM_Pipeline_Concurrent)->Apply(PipelineArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_RandomTTree_Generation(benchmark::State &state){
+   // Parameters
+   UInt_t nVars = 4;
+   UInt_t nEvents = state.range(0);
+   Bool_t parallel = state.range(1);
+   UInt_t nThreads = state.range(2);
+
+   // Benchmarking
+   perf_recorder perf;
+   for(auto _: state){
+      TTree *tree = parallel ? genTreeMT("genTree", nEvents, nVars, 0.3, 0.5, 100, true, nThreads)
+                             : genTree("genTree", nEvents, nVars, 0.3, 0.5, 100);
+      delete tree;
+   }
+   perf.Report(state);
+
+   // Generation throughput, in events per second
+   state.SetItemsProcessed(state.iterations() * nEvents);
+}
+// Serial generation runs single-threaded only, whereas parallel generation is swept across thread counts
+static void RandomTTreeGenerationArgs(benchmark::internal::Benchmark* b){
+   for(int64_t nEvents: {100000, 1000000, 10000000}){
+      b->Args({nEvents, 0, 1});
+      for(int64_t nThreads: {1, 4, 8, 16}){
+         b->Args({nEvents, 1, nThreads});
+      }
+   }
+}
+BENCHMARK(BM_RandomTTree_Generation)->Apply(RandomTTreeGenerationArgs)->Unit(benchmark::kMillisecond);
 
 BENCHMARK_MAIN();
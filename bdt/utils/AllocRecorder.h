@@ -0,0 +1,45 @@
+#ifndef BDTBENCH_ALLOCRECORDER_H
+#define BDTBENCH_ALLOCRECORDER_H
+
+#include <algorithm>
+
+#include "benchmark/benchmark.h"
+#include "rootbench/MemoryTracker.h"
+
+/* Records the allocations made inside a region of a benchmarking loop (see RB::AllocTracker), and reports them as
+ * benchmark counters: bytes allocated and number of allocations per iteration, and the peak live bytes of the region
+ * over all iterations. Unlike the resident set size, the counters are not hidden by memory which the allocator keeps
+ * around between iterations, and are exact for every configuration of a benchmark:
+ *
+ *    alloc_recorder allocs;
+ *    for(auto _: state){
+ *       allocs.Start();
+ *       ...
+ *       allocs.Stop();
+ *    }
+ *    allocs.Report(state);
+ */
+typedef struct alloc_recorder{
+    Double_t allocated_bytes = 0.0;
+    Double_t allocations = 0.0;
+    Long64_t peak_live_bytes = 0;
+
+    void Start(){ RB::StartAllocTracking(); }
+
+    void Stop(){
+        RB::AllocStats stats = RB::StopAllocTracking();
+        allocated_bytes += stats.fAllocatedBytes;
+        allocations += stats.fAllocations;
+        peak_live_bytes = std::max<Long64_t>(peak_live_bytes, stats.fPeakLiveBytes);
+    }
+
+    // Sets the counters of the given benchmark state (none if allocations cannot be tracked on this platform).
+    void Report(benchmark::State& state){
+        if(!RB::IsAllocTrackingSupported()){ return; }
+        state.counters["Allocated Bytes"] = benchmark::Counter(allocated_bytes, benchmark::Counter::kAvgIterations);
+        state.counters["Allocations"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+        state.counters["Peak Live Bytes"] = peak_live_bytes;
+    }
+} alloc_recorder;
+
+#endif //BDTBENCH_ALLOCRECORDER_H
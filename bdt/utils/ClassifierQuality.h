@@ -0,0 +1,70 @@
+#ifndef BDTBENCH_CLASSIFIERQUALITY_H
+#define BDTBENCH_CLASSIFIERQUALITY_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+/* Records the signal probabilities predicted by a classifier for the events of a labelled test sample, and reports its
+ * quality as benchmark counters: the area under the ROC curve (signal being the positive class) and the log-loss, such
+ * that the timings of a configuration can be weighed against the quality of the model it produced. The AUC only depends
+ * on the ranking of the events, hence is meaningful for any score, whereas the log-loss is only meaningful for outputs
+ * which are probabilities (e.g. not for the vote of an AdaBoost forest), and is hence only reported for these:
+ *
+ *    classifier_quality quality;
+ *    for(...){ quality.Add(p_signal, is_signal); }
+ *    quality.Report(state);
+ */
+typedef struct classifier_quality{
+    // Probabilities are clipped to [epsilon, 1 - epsilon] in the log-loss, which keeps it finite for hard outputs
+    static constexpr Double_t epsilon = 1e-15;
+
+    std::vector<std::pair<Double_t, bool>> events; // (signal probability, is signal)
+
+    void Add(Double_t p_signal, bool signal){ events.emplace_back(p_signal, signal); }
+
+    /* Area under the ROC curve, i.e. the probability that a signal event is ranked above a background event (ties
+     * counting one half), from the Mann-Whitney U statistic of the average ranks. 0.5 if either class is empty.
+     */
+    Double_t AUC(){
+        std::sort(events.begin(), events.end());
+
+        Double_t n_signal = 0.0, signal_rank_sum = 0.0;
+        for(size_t i = 0; i < events.size();){
+            size_t end = i;
+            while(end < events.size() && events[end].first == events[i].first){ end++; }
+            const Double_t rank = 0.5 * (i + 1 + end); // average of the ranks i + 1 ... end
+            for(size_t k = i; k < end; k++){
+                if(events[k].second){ n_signal++; signal_rank_sum += rank; }
+            }
+            i = end;
+        }
+
+        const Double_t n_background = events.size() - n_signal;
+        if(n_signal == 0 || n_background == 0){ return 0.5; }
+        return (signal_rank_sum - n_signal * (n_signal + 1) / 2) / (n_signal * n_background);
+    }
+
+    // Mean binary cross-entropy of the predicted signal probabilities.
+    Double_t LogLoss() const{
+        if(events.empty()){ return 0.0; }
+        Double_t loss = 0.0;
+        for(auto& event: events){
+            const Double_t p = std::min(std::max(event.first, epsilon), 1.0 - epsilon);
+            loss -= event.second ? std::log(p) : std::log(1.0 - p);
+        }
+        return loss / events.size();
+    }
+
+    // Sets the "Test AUC" counter of the given benchmark state, and the "Test Log-Loss" one if the outputs recorded are
+    // probabilities.
+    void Report(benchmark::State& state, bool probabilities = true){
+        state.counters["Test AUC"] = AUC();
+        if(probabilities){ state.counters["Test Log-Loss"] = LogLoss(); }
+    }
+} classifier_quality;
+
+#endif //BDTBENCH_CLASSIFIERQUALITY_H
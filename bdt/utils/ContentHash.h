@@ -0,0 +1,40 @@
+#ifndef BDTBENCH_CONTENTHASH_H
+#define BDTBENCH_CONTENTHASH_H
+
+#include <cstring>
+#include <string>
+
+#include "Rtypes.h"
+
+// Offset basis of the 64-bit FNV-1a hash, used as the initial value of content_hash
+const ULong64_t content_hash_seed = 14695981039346656037ULL;
+
+/* 64-bit FNV-1a hash of the given buffer, which can be chained across buffers by passing the previous hash as seed.
+ * The buffer is consumed in 8-byte words (with the tail being consumed byte by byte), which is considerably faster than
+ * the canonical byte-wise variant while being as good for the purpose of content addressing caches.
+ */
+ULong64_t content_hash(const void* buf, size_t n_bytes, ULong64_t hash = content_hash_seed){
+    const ULong64_t prime = 1099511628211ULL;
+    auto bytes = static_cast<const unsigned char*>(buf);
+
+    size_t i = 0;
+    for(; i + sizeof(ULong64_t) <= n_bytes; i += sizeof(ULong64_t)){
+        ULong64_t word;
+        memcpy(&word, bytes + i, sizeof(ULong64_t));
+        hash = (hash ^ word) * prime;
+    }
+    for(; i < n_bytes; i++){
+        hash = (hash ^ bytes[i]) * prime;
+    }
+
+    return hash;
+}
+
+// Renders a hash as a fixed-width hexadecimal string, suitable for use in file names.
+std::string content_hash_str(ULong64_t hash){
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", hash);
+    return buf;
+}
+
+#endif //BDTBENCH_CONTENTHASH_H
@@ -0,0 +1,101 @@
+#ifndef BDTBENCH_DMATRIXCACHE_H
+#define BDTBENCH_DMATRIXCACHE_H
+
+#include <fstream>
+
+#include <unistd.h>
+
+#include "ContentHash.h"
+#include "root2xgboost.h"
+
+/* On-disk cache of the DMatrix instances built from TMVA data sets, such that repeated benchmark runs and parameter
+ * sweeps over the same data set load the DMatrix in a single file read, rather than converting it from the DataSet.
+ *
+ * Cache entries are stored in XGBoost's binary DMatrix format (XGDMatrixSaveBinary), which holds the raw values and
+ * labels: the quantile sketch and the bins of the hist method are not part of it (XGBoost's C API offers no way of
+ * persisting a quantised DMatrix), so they are still computed by the first boosting round of each run. Entries hence
+ * do not depend on training parameters such as max_bin, and are shared by all of them.
+ *
+ * Entries are keyed by a description of the source of the data set given by the caller (e.g. the paths of the
+ * content-addressed column caches it was generated from), rather than by a hash of its contents, which would take a
+ * pass over all the events on every lookup; see xgboost_dataset_key.
+ */
+
+/* Key of the data set of the given tree type, from the given description of its source together with its shape and
+ * the values and labels of its first and last events. These only take a few events to compute, and catch a source
+ * description which does not match the data set (e.g. a different split of the same source).
+ */
+ULong64_t xgboost_dataset_key(const TMVA::DataSetInfo& dataset_info, TMVA::Types::ETreeType type, const string& source){
+    TMVA::DataSet* dataset = dataset_info.GetDataSet();
+    const auto n_vars = dataset->GetNVariables();
+    Long64_t n_sig, n_bgd;
+    count_xgboost_events(dataset, type, n_sig, n_bgd);
+
+    ULong64_t hash = content_hash(source.data(), source.size());
+    hash = content_hash(&type, sizeof(type), hash);
+    hash = content_hash(&n_vars, sizeof(n_vars), hash);
+    hash = content_hash(&n_sig, sizeof(n_sig), hash);
+    hash = content_hash(&n_bgd, sizeof(n_bgd), hash);
+
+    const vector<TMVA::Event*>& events = dataset->GetEventCollection(type);
+    if(!events.empty()){
+        for(const TMVA::Event* event: {events.front(), events.back()}){
+            const Float_t label = dataset_info.IsSignal(event) ? 0.0 : 1.0;
+            hash = content_hash(event->GetValues().data(), n_vars * sizeof(Float_t), hash);
+            hash = content_hash(&label, sizeof(label), hash);
+        }
+    }
+
+    return hash;
+}
+
+// Path of the cache entry for the given data set key.
+string xgboost_cache_path(ULong64_t key, const string& prefix = "bdt_xgb_bench_dmatrix"){
+    return prefix + "_" + content_hash_str(key) + ".buffer";
+}
+
+/* Returns the DMatrix for the events of the given tree type, loading it from the cache if an entry for the data set
+ * (see xgboost_dataset_key for the source description) exists, or otherwise converting it via ROOTToXGBoost and storing
+ * it in the cache. If given, cache_hit is set to whether the DMatrix was loaded from the cache.
+ *
+ * On a cache hit, the labels are only held by the DMatrix itself: as for the streaming conversions, the labels and
+ * weights arrays of the returned xgboost_data instance are not allocated.
+ */
+xgboost_data* ROOTToXGBoostCached(const TMVA::DataSetInfo& dataset_info, TMVA::Types::ETreeType type,
+                                  const string& source, bool* cache_hit = nullptr,
+                                  const string& prefix = "bdt_xgb_bench_dmatrix"){
+    const string path = xgboost_cache_path(xgboost_dataset_key(dataset_info, type, source), prefix);
+    const bool hit = ifstream(path).good();
+    if(cache_hit != nullptr){ *cache_hit = hit; }
+
+    if(!hit){ // Cache miss: convert from the DataSet and store the entry, writing to a temporary file (unique to the
+              // process) first such that concurrent runs never observe a partially written entry
+        xgboost_data* data = ROOTToXGBoost(dataset_info, type);
+        const string tmp_path = path + "." + to_string(getpid()) + ".tmp";
+        safe_xgboost(XGDMatrixSaveBinary((data->sb_dmats)[0], tmp_path.c_str(), 1))
+        if(rename(tmp_path.c_str(), path.c_str()) != 0){
+            throw runtime_error("Failed to store DMatrix cache entry " + path);
+        }
+
+        return data;
+    }
+
+    // Cache hit: load the DMatrix, checking that it holds as many events as the data set
+    Long64_t n_sig, n_bgd;
+    count_xgboost_events(dataset_info.GetDataSet(), type, n_sig, n_bgd);
+
+    auto data = new xgboost_data(n_sig, n_bgd, false);
+    safe_xgboost(XGDMatrixCreateFromFile(path.c_str(), 1, &((data->sb_dmats)[0])))
+
+    bst_ulong n_rows;
+    safe_xgboost(XGDMatrixNumRow((data->sb_dmats)[0], &n_rows))
+    if((Long64_t) n_rows != n_sig + n_bgd){
+        data->free();
+        delete data;
+        throw runtime_error("DMatrix cache entry " + path + " does not match the data set.");
+    }
+
+    return data;
+}
+
+#endif //BDTBENCH_DMATRIXCACHE_H
@@ -0,0 +1,459 @@
+#ifndef BDTBENCH_FLATFOREST_H
+#define BDTBENCH_FLATFOREST_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "ROOT/TSeq.hxx"
+#include "ROOT/TThreadExecutor.hxx"
+#include "TXMLEngine.h"
+
+#include "MiniJSON.h"
+
+/* Native inference engine for the forests trained by TMVA (BDT weight XML files) and XGBoost (JSON model files), which
+ * scores events without going through either framework's runtime.
+ *
+ * The forest is held as a struct-of-arrays node table in a single contiguous, cache-line aligned arena. Trees are laid
+ * out one after the other, each in breadth-first order, with the two children of a node being adjacent, such that an
+ * event at inner node i continues to node left[i] if its value of feature[i] is below threshold[i], and to node
+ * left[i] + 1 otherwise. Leaves are marked by a negative feature index, and carry their contribution to the score in
+ * value[], which already includes any per-tree weight or normalisation of the model, such that the output of the forest
+ * is always transform(base_score + sum of the leaf values reached).
+ */
+
+// Transformation of the summed leaf values (the margin) into the output of the model.
+enum flat_forest_transform{
+    kForestIdentity, // margin as is (XGBoost reg:squarederror, binary:logitraw, TMVA AdaBoost)
+    kForestSigmoid,  // 1 / (1 + exp(-margin)) (XGBoost binary:logistic)
+    kForestTMVAGrad  // 2 / (1 + exp(-2 margin)) - 1 (TMVA gradient boosting)
+};
+
+// Alignment of the arrays in the node table arena, and the number of events scored together against each tree.
+const size_t flat_forest_alignment = 64;
+const size_t flat_forest_block_size = 64;
+const size_t flat_forest_task_size = 4096;
+
+/* Thread pool of n_threads threads, created on first use and kept for the lifetime of the process, such that scoring
+ * does not pay for the creation of a pool on each call.
+ */
+ROOT::TThreadExecutor& flat_forest_pool(UInt_t n_threads){
+    static std::mutex mutex;
+    static std::map<UInt_t, std::unique_ptr<ROOT::TThreadExecutor>> pools;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& pool = pools[n_threads];
+    if(!pool){ pool.reset(new ROOT::TThreadExecutor(n_threads)); }
+    return *pool;
+}
+
+/* Splits the events [0, n_events) into tasks of flat_forest_task_size events, calling score(begin, end) for each task
+ * on the pool of n_threads threads (or serially if n_threads is 1, or if there is a single task only).
+ */
+template<class F> void flat_forest_foreach_task(size_t n_events, UInt_t n_threads, F score){
+    if(n_threads == 1 || n_events <= flat_forest_task_size){
+        score(0, n_events);
+        return;
+    }
+
+    const ULong_t n_tasks = (n_events + flat_forest_task_size - 1) / flat_forest_task_size;
+    auto score_task = [&](ULong_t task){
+        const size_t begin = task * flat_forest_task_size;
+        score(begin, std::min(begin + flat_forest_task_size, n_events));
+    };
+
+    flat_forest_pool(n_threads).Foreach(score_task, ROOT::TSeqUL(n_tasks));
+}
+
+/* Node of a tree as read from a model file, before flattening; the children are indices into the same tree, with the
+ * root at index 0. An event goes to the left child if its value of the split feature is below the threshold, and to
+ * the left (right) child if it is missing (NaN) and default_left is set (unset).
+ */
+typedef struct forest_node{
+    Int_t feature;      // split feature, -1 for leaves
+    Float_t threshold;
+    Int_t left, right;
+    Float_t value;      // leaf value
+    bool default_left;
+} forest_node;
+
+typedef std::vector<forest_node> forest_tree;
+
+typedef struct flat_forest{
+    UInt_t n_trees = 0;
+    UInt_t n_nodes = 0;
+    UInt_t n_features = 0;
+    UInt_t max_depth = 0;
+
+    flat_forest_transform transform = kForestIdentity;
+    Double_t base_score = 0.0;
+
+    // Node table, indexed by global node index
+    Int_t* feature = nullptr;
+    Float_t* threshold = nullptr;
+    Int_t* left = nullptr;
+    Float_t* value = nullptr;
+    UChar_t* default_left = nullptr;
+
+    // Tree table, with the global node index of the root and the depth of each tree
+    Int_t* roots = nullptr;
+    Int_t* depths = nullptr;
+
+    void* arena = nullptr;
+    size_t arena_size = 0;
+
+    // Memory mapping holding the arena, if the forest was mapped from a file (see FlatForestFile.h)
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    void free(){
+        if(mapping){
+            munmap(mapping, mapping_size);
+        }else{
+            std::free(arena);
+        }
+        arena = mapping = nullptr;
+    }
+
+    // Returns the global index of the leaf of the given tree which the event x (with features feature_stride apart)
+    // ends up in.
+    Int_t Leaf(UInt_t tree, const Float_t* x, size_t feature_stride = 1) const{
+        Int_t node = roots[tree];
+        while(feature[node] >= 0){
+            const Float_t v = x[feature[node] * feature_stride];
+            node = left[node] + (v >= threshold[node] || (std::isnan(v) && !default_left[node]));
+        }
+        return node;
+    }
+
+    Float_t Transform(Double_t margin) const{
+        switch(transform){
+            case kForestSigmoid: return 1.0 / (1.0 + std::exp(-margin));
+            case kForestTMVAGrad: return 2.0 / (1.0 + std::exp(-2.0 * margin)) - 1.0;
+            default: return margin;
+        }
+    }
+
+    // Output of the model for a single event.
+    Float_t Predict(const Float_t* x, size_t feature_stride = 1) const{
+        Double_t margin = base_score;
+        for(UInt_t t = 0; t < n_trees; t++){ margin += value[Leaf(t, x, feature_stride)]; }
+        return Transform(margin);
+    }
+
+    /* Output of the model for the events [begin, end) of a data set, with the value of feature j of event i being held
+     * at data[i * row_stride + j * feature_stride] (i.e. row_stride = n_features and feature_stride = 1 for row-major
+     * data, and row_stride = 1 and feature_stride = n_events for column-major data). Events are scored in blocks, each
+     * block being run through one tree after the other, such that the nodes of a tree stay in cache across the block.
+     */
+    void PredictRange(const Float_t* data, size_t begin, size_t end, size_t row_stride, size_t feature_stride,
+                      Float_t* out) const{
+        Double_t margins[flat_forest_block_size];
+        for(size_t block = begin; block < end; block += flat_forest_block_size){
+            const size_t n = std::min(flat_forest_block_size, end - block);
+            std::fill(margins, margins + n, base_score);
+
+            for(UInt_t t = 0; t < n_trees; t++){
+                for(size_t i = 0; i < n; i++){
+                    margins[i] += value[Leaf(t, data + (block + i) * row_stride, feature_stride)];
+                }
+            }
+
+            for(size_t i = 0; i < n; i++){ out[block + i] = Transform(margins[i]); }
+        }
+    }
+
+    // Output of the model for all n_events events of a data set (see PredictRange), scored by n_threads threads.
+    void Predict(const Float_t* data, size_t n_events, size_t row_stride, size_t feature_stride, Float_t* out,
+                 UInt_t n_threads = 1) const{
+        flat_forest_foreach_task(n_events, n_threads, [&](size_t begin, size_t end){
+            PredictRange(data, begin, end, row_stride, feature_stride, out);
+        });
+    }
+} flat_forest;
+
+/* Layout of the node and tree tables in the arena: the arrays feature, threshold, left, value, default_left, roots and
+ * depths, in this order, each starting on its own cache line. Fills the offsets of the arrays, and returns the size of
+ * the arena.
+ */
+size_t flat_forest_arena_layout(UInt_t n_trees, UInt_t n_nodes, size_t offsets[7]){
+    const size_t sizes[7] = {n_nodes * sizeof(Int_t), n_nodes * sizeof(Float_t), n_nodes * sizeof(Int_t),
+                             n_nodes * sizeof(Float_t), n_nodes * sizeof(UChar_t), n_trees * sizeof(Int_t),
+                             n_trees * sizeof(Int_t)};
+    size_t size = 0;
+    for(Int_t i = 0; i < 7; i++){
+        offsets[i] = size;
+        size += (sizes[i] + flat_forest_alignment - 1) / flat_forest_alignment * flat_forest_alignment;
+    }
+    return size;
+}
+
+size_t flat_forest_arena_size(UInt_t n_trees, UInt_t n_nodes){
+    size_t offsets[7];
+    return flat_forest_arena_layout(n_trees, n_nodes, offsets);
+}
+
+// Points the tables of the forest (whose n_trees and n_nodes are set) into the given arena.
+void bind_flat_forest_arena(flat_forest& forest, void* arena){
+    size_t offsets[7];
+    flat_forest_arena_layout(forest.n_trees, forest.n_nodes, offsets);
+
+    char* base = (char*) arena;
+    forest.arena = arena;
+    forest.feature = (Int_t*) (base + offsets[0]);
+    forest.threshold = (Float_t*) (base + offsets[1]);
+    forest.left = (Int_t*) (base + offsets[2]);
+    forest.value = (Float_t*) (base + offsets[3]);
+    forest.default_left = (UChar_t*) (base + offsets[4]);
+    forest.roots = (Int_t*) (base + offsets[5]);
+    forest.depths = (Int_t*) (base + offsets[6]);
+}
+
+/* Flattens the given trees into a flat_forest, renumbering the nodes of each tree in breadth-first order such that
+ * siblings are adjacent. Nodes which are unreachable from the root of their tree are dropped.
+ */
+flat_forest* flatten_forest(const std::vector<forest_tree>& trees, UInt_t n_features, flat_forest_transform transform,
+                            Double_t base_score){
+    // Breadth-first renumbering, as the source node index (and tree-local depth) of each node of the flat forest
+    std::vector<const forest_node*> src;
+    std::vector<Int_t> src_depth, roots, depths;
+    std::vector<Int_t> left;
+
+    for(auto& tree: trees){
+        if(tree.empty()){ throw std::runtime_error("Cannot flatten a tree without nodes."); }
+
+        const size_t root = src.size();
+        roots.push_back(root);
+        src.push_back(&tree[0]);
+        src_depth.push_back(0);
+
+        Int_t depth = 0;
+        for(size_t k = root; k < src.size(); k++){
+            const forest_node& node = *src[k];
+            depth = std::max(depth, src_depth[k]);
+            if(node.feature < 0){ left.push_back(-1); continue; }
+
+            if(node.left < 0 || node.right < 0 || (size_t) node.left >= tree.size()
+               || (size_t) node.right >= tree.size()){
+                throw std::runtime_error("Invalid child index in tree.");
+            }
+            left.push_back(src.size());
+            src.push_back(&tree[node.left]);
+            src.push_back(&tree[node.right]);
+            src_depth.push_back(src_depth[k] + 1);
+            src_depth.push_back(src_depth[k] + 1);
+        }
+        depths.push_back(depth);
+    }
+
+    // Carve the arrays out of a single arena, each starting on its own cache line
+    auto forest = new flat_forest();
+    forest->n_trees = trees.size();
+    forest->n_nodes = src.size();
+    forest->n_features = n_features;
+    forest->max_depth = depths.empty() ? 0 : *std::max_element(depths.begin(), depths.end());
+    forest->transform = transform;
+    forest->base_score = base_score;
+
+    forest->arena_size = flat_forest_arena_size(forest->n_trees, forest->n_nodes);
+    void* arena = aligned_alloc(flat_forest_alignment, std::max(forest->arena_size, flat_forest_alignment));
+    if(!arena){ delete forest; throw std::runtime_error("Failed to allocate the flat forest arena."); }
+    bind_flat_forest_arena(*forest, arena);
+
+    for(UInt_t k = 0; k < forest->n_nodes; k++){
+        const forest_node& node = *src[k];
+        const bool leaf = node.feature < 0;
+        forest->feature[k] = leaf ? -1 : node.feature;
+        forest->threshold[k] = leaf ? 0.0f : node.threshold;
+        forest->left[k] = left[k];
+        forest->value[k] = leaf ? node.value : 0.0f;
+        forest->default_left[k] = node.default_left;
+    }
+    std::copy(roots.begin(), roots.end(), forest->roots);
+    std::copy(depths.begin(), depths.end(), forest->depths);
+
+    return forest;
+}
+
+// Reads a TMVA DecisionTreeNode (and its subtree) from a weights file into tree, returning its index.
+Int_t read_tmva_node(TXMLEngine& xml, XMLNodePointer_t xml_node, forest_tree& tree, bool grad, bool yes_no_leaf){
+    if(atoi(xml.GetAttr(xml_node, "NCoef")) > 0){
+        throw std::runtime_error("TMVA BDTs with Fisher cuts are not supported.");
+    }
+
+    const Int_t index = tree.size();
+    tree.push_back(forest_node());
+
+    // Inner nodes are of node type 0, whatever the children they might still hold (see DecisionTree::CheckEvent)
+    const Int_t node_type = atoi(xml.GetAttr(xml_node, "nType"));
+    if(node_type != 0){
+        Double_t leaf_value = grad ? atof(xml.GetAttr(xml_node, "res"))
+                                   : (yes_no_leaf ? node_type : atof(xml.GetAttr(xml_node, "purity")));
+        tree[index] = {-1, 0.0f, -1, -1, (Float_t) leaf_value, true};
+        return index;
+    }
+
+    Int_t tmva_left = -1, tmva_right = -1;
+    for(auto child = xml.GetChild(xml_node); child; child = xml.GetNext(child)){
+        if(strcmp(xml.GetNodeName(child), "Node") != 0){ continue; }
+        Int_t child_index = read_tmva_node(xml, child, tree, grad, yes_no_leaf);
+        (xml.GetAttr(child, "pos")[0] == 'l' ? tmva_left : tmva_right) = child_index;
+    }
+    if(tmva_left < 0 || tmva_right < 0){ throw std::runtime_error("Inner node without two children in TMVA tree."); }
+
+    /* TMVA sends an event to the right child if (x >= cut) == cType (see DecisionTreeNode::GoesRight), comparing as
+     * floats; with cType unset the children are hence swapped. A missing value fails x >= cut, and so always ends up
+     * in the (possibly swapped) left child.
+     */
+    const bool cut_type = atoi(xml.GetAttr(xml_node, "cType"));
+    forest_node& node = tree[index];
+    node.feature = atoi(xml.GetAttr(xml_node, "IVar"));
+    node.threshold = (Float_t) atof(xml.GetAttr(xml_node, "Cut"));
+    node.left = cut_type ? tmva_left : tmva_right;
+    node.right = cut_type ? tmva_right : tmva_left;
+    node.value = 0.0f;
+    node.default_left = true;
+
+    return index;
+}
+
+/* Loads the forest of a TMVA BDT classifier from its weights XML file. The output matches MethodBDT::GetMvaValue: for
+ * gradient boosting, the transformed sum of the leaf responses; otherwise, the boost-weighted average over the trees of
+ * the leaf node types (UseYesNoLeaf) or purities. Input variable transformations are not supported.
+ */
+flat_forest* TMVAToFlatForest(const std::string& weights_file){
+    TXMLEngine xml;
+    XMLDocPointer_t doc = xml.ParseFile(weights_file.c_str());
+    if(!doc){ throw std::runtime_error("Failed to parse TMVA weights file " + weights_file); }
+
+    try{
+        XMLNodePointer_t setup = xml.DocGetRootElement(doc);
+
+        std::string boost_type = "AdaBoost";
+        bool yes_no_leaf = true;
+        UInt_t n_features = 0;
+        std::vector<forest_tree> trees;
+        std::vector<Double_t> boost_weights;
+
+        for(auto section = xml.GetChild(setup); section; section = xml.GetNext(section)){
+            std::string name = xml.GetNodeName(section);
+
+            if(name == "Options"){
+                for(auto option = xml.GetChild(section); option; option = xml.GetNext(option)){
+                    std::string option_name = xml.GetAttr(option, "name");
+                    const char* content = xml.GetNodeContent(option);
+                    std::string option_value = content ? content : "";
+                    if(option_name == "BoostType"){ boost_type = option_value; }
+                    else if(option_name == "UseYesNoLeaf"){ yes_no_leaf = (option_value == "True"); }
+                }
+            }else if(name == "Variables"){
+                n_features = atoi(xml.GetAttr(section, "NVar"));
+            }else if(name == "Transformations"){
+                if(atoi(xml.GetAttr(section, "NTransformations")) != 0){
+                    throw std::runtime_error("TMVA input variable transformations are not supported.");
+                }
+            }else if(name == "Weights"){
+                const bool grad = (boost_type == "Grad");
+                for(auto tree = xml.GetChild(section); tree; tree = xml.GetNext(tree)){
+                    if(strcmp(xml.GetNodeName(tree), "BinaryTree") != 0){ continue; }
+                    boost_weights.push_back(atof(xml.GetAttr(tree, "boostWeight")));
+                    trees.emplace_back();
+                    read_tmva_node(xml, xml.GetChild(tree), trees.back(), grad, yes_no_leaf);
+                }
+            }
+        }
+        xml.FreeDoc(doc);
+
+        if(boost_type == "Grad"){ return flatten_forest(trees, n_features, kForestTMVAGrad, 0.0); }
+
+        // Fold the boost weights and their normalisation into the leaf values
+        Double_t norm = 0.0;
+        for(Double_t w: boost_weights){ norm += w; }
+        for(size_t t = 0; t < trees.size(); t++){
+            const Double_t scale = (norm > std::numeric_limits<Double_t>::epsilon()) ? boost_weights[t] / norm : 0.0;
+            for(auto& node: trees[t]){ node.value = node.value * scale; }
+        }
+        return flatten_forest(trees, n_features, kForestIdentity, 0.0);
+    }catch(...){
+        xml.FreeDoc(doc);
+        throw;
+    }
+}
+
+/* Loads the forest of an XGBoost gbtree model from its JSON model file (XGBoosterSaveModel to a .json file). The
+ * base score is converted to a margin according to the objective, with the reg:squarederror, reg:logistic,
+ * binary:logistic and binary:logitraw objectives being supported.
+ */
+flat_forest* XGBoostToFlatForest(const std::string& json_file){
+    std::ifstream in(json_file, std::ios::binary);
+    if(!in){ throw std::runtime_error("Failed to open XGBoost model " + json_file); }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    json_value learner = json_parse(text)["learner"];
+    json_value model_param = learner["learner_model_param"];
+    json_value booster = learner["gradient_booster"];
+
+    if(booster["name"].str() != "gbtree"){ throw std::runtime_error("Only XGBoost gbtree models are supported."); }
+    if(model_param["num_class"].to_int() > 1){ throw std::runtime_error("Multi-class XGBoost models are not supported."); }
+
+    const UInt_t n_features = model_param["num_feature"].to_int();
+    const Double_t base_score = model_param["base_score"].to_double();
+    const std::string objective = learner["objective"]["name"].str();
+
+    flat_forest_transform transform;
+    Double_t base_margin;
+    if(objective == "reg:squarederror" || objective == "reg:linear"){
+        transform = kForestIdentity;
+        base_margin = base_score;
+    }else if(objective == "binary:logistic" || objective == "reg:logistic" || objective == "binary:logitraw"){
+        transform = (objective == "binary:logitraw") ? kForestIdentity : kForestSigmoid;
+        base_margin = -std::log(1.0 / base_score - 1.0);
+    }else{
+        throw std::runtime_error("Unsupported XGBoost objective " + objective);
+    }
+
+    std::vector<forest_tree> trees;
+    std::vector<Int_t> lefts, rights, indices;
+    std::vector<Float_t> conditions;
+    std::vector<UChar_t> default_lefts;
+    for(auto& tree_json: booster["model"]["trees"].elements()){
+        for(auto& member: tree_json.members()){
+            if(member.first == "left_children"){ member.second.to_vector(lefts); }
+            else if(member.first == "right_children"){ member.second.to_vector(rights); }
+            else if(member.first == "split_indices"){ member.second.to_vector(indices); }
+            else if(member.first == "split_conditions"){ member.second.to_vector(conditions); }
+            else if(member.first == "default_left"){ member.second.to_vector(default_lefts); }
+        }
+
+        const size_t n_nodes = lefts.size();
+        if(rights.size() != n_nodes || indices.size() != n_nodes || conditions.size() != n_nodes
+           || default_lefts.size() != n_nodes){
+            throw std::runtime_error("Inconsistent node arrays in XGBoost tree.");
+        }
+
+        // XGBoost sends an event to the left child if x < split_condition, leaves holding their value in place of it
+        trees.emplace_back(n_nodes);
+        for(size_t i = 0; i < n_nodes; i++){
+            const bool leaf = (lefts[i] == -1);
+            trees.back()[i] = {leaf ? -1 : indices[i], conditions[i], lefts[i], rights[i], leaf ? conditions[i] : 0.0f,
+                               (bool) default_lefts[i]};
+        }
+    }
+
+    return flatten_forest(trees, n_features, transform, base_margin);
+}
+
+#endif //BDTBENCH_FLATFOREST_H
@@ -0,0 +1,132 @@
+#ifndef BDTBENCH_FLATFORESTFILE_H
+#define BDTBENCH_FLATFORESTFILE_H
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FlatForest.h"
+
+/* Compact binary file format for flat forests, which is the arena of the forest preceded by a fixed-size header, such
+ * that a forest can be memory-mapped and scored straight from the page cache, without any parsing nor copying. The
+ * header takes up a full cache line, which keeps the arrays of the mapped arena aligned as in memory.
+ *
+ * Files are written in the byte order of the machine, which is recorded in the header together with the version of the
+ * format; readers reject files of another version or byte order. Beyond the header and the size of the file, the
+ * contents are trusted, i.e. files are meant to be produced by WriteFlatForest from a validated model.
+ */
+
+const char flat_forest_file_magic[8] = {'B', 'D', 'T', 'F', 'L', 'A', 'T', '\0'};
+const UInt_t flat_forest_file_version = 1;
+const UInt_t flat_forest_file_byte_order = 0x01020304;
+
+typedef struct flat_forest_file_header{
+    char magic[8];
+    UInt_t version;
+    UInt_t byte_order;
+    UInt_t n_trees;
+    UInt_t n_nodes;
+    UInt_t n_features;
+    UInt_t max_depth;
+    Int_t transform;
+    UInt_t reserved;
+    Double_t base_score;
+    ULong64_t arena_size;
+    char padding[8];
+} flat_forest_file_header;
+
+static_assert(sizeof(flat_forest_file_header) == flat_forest_alignment,
+              "The flat forest file header must keep the arena aligned.");
+
+// Writes the forest to the given file. Throws if the file cannot be written.
+void WriteFlatForest(const flat_forest& forest, const std::string& path){
+    flat_forest_file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, flat_forest_file_magic, sizeof(header.magic));
+    header.version = flat_forest_file_version;
+    header.byte_order = flat_forest_file_byte_order;
+    header.n_trees = forest.n_trees;
+    header.n_nodes = forest.n_nodes;
+    header.n_features = forest.n_features;
+    header.max_depth = forest.max_depth;
+    header.transform = forest.transform;
+    header.base_score = forest.base_score;
+    header.arena_size = forest.arena_size;
+
+    std::ofstream out(path, std::ios::binary);
+    out.write((const char*) &header, sizeof(header));
+    out.write((const char*) forest.arena, forest.arena_size);
+    if(!out){ throw std::runtime_error("Failed to write flat forest file " + path); }
+}
+
+/* Maps the forest of the given file into memory (read-only), which is all loading amounts to: pages of the arena are
+ * only read from the file (or page cache) as inference touches them. The mapping is released by flat_forest::free.
+ * Throws if the file cannot be mapped or is not a flat forest file of this version and byte order.
+ */
+flat_forest* MapFlatForest(const std::string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){ throw std::runtime_error("Failed to open flat forest file " + path); }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(flat_forest_file_header)){
+        close(fd);
+        throw std::runtime_error("Not a flat forest file: " + path);
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){ throw std::runtime_error("Failed to map flat forest file " + path); }
+
+    const flat_forest_file_header& header = *(const flat_forest_file_header*) mapping;
+    std::string error;
+    if(std::memcmp(header.magic, flat_forest_file_magic, sizeof(header.magic)) != 0){
+        error = "Not a flat forest file: ";
+    }else if(header.version != flat_forest_file_version){
+        error = "Unsupported flat forest file version " + std::to_string(header.version) + ": ";
+    }else if(header.byte_order != flat_forest_file_byte_order){
+        error = "Flat forest file of another byte order: ";
+    }else if(header.arena_size != flat_forest_arena_size(header.n_trees, header.n_nodes)
+             || sizeof(header) + header.arena_size > (size_t) st.st_size){
+        error = "Truncated or corrupted flat forest file: ";
+    }
+    if(!error.empty()){
+        munmap(mapping, st.st_size);
+        throw std::runtime_error(error + path);
+    }
+
+    auto forest = new flat_forest();
+    forest->n_trees = header.n_trees;
+    forest->n_nodes = header.n_nodes;
+    forest->n_features = header.n_features;
+    forest->max_depth = header.max_depth;
+    forest->transform = (flat_forest_transform) header.transform;
+    forest->base_score = header.base_score;
+    forest->arena_size = header.arena_size;
+    forest->mapping = mapping;
+    forest->mapping_size = st.st_size;
+    bind_flat_forest_arena(*forest, (char*) mapping + sizeof(header));
+
+    return forest;
+}
+
+// Converts the given TMVA BDT weights file into a flat forest file.
+void TMVAToFlatForestFile(const std::string& weights, const std::string& path){
+    flat_forest* forest = TMVAToFlatForest(weights);
+    try{
+        WriteFlatForest(*forest, path);
+    }catch(...){
+        forest->free();
+        delete forest;
+        throw;
+    }
+    forest->free();
+    delete forest;
+}
+
+#endif //BDTBENCH_FLATFORESTFILE_H
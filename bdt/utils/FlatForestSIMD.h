@@ -0,0 +1,225 @@
+#ifndef BDTBENCH_FLATFORESTSIMD_H
+#define BDTBENCH_FLATFORESTSIMD_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FlatForest.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BDTBENCH_FOREST_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* Vectorised inference kernels for flat_forest, which walk 8 (AVX2) or 16 (AVX-512) events through a tree at once.
+ *
+ * Each lane holds the node an event is at; every step gathers the split feature, threshold, default direction and left
+ * child of the nodes of all lanes, gathers the feature values of the events, and moves each lane to its left or right
+ * child by adding the (masked) comparison result to the left child index. Lanes which reached a leaf are masked out of
+ * the update, and a tree is done after as many steps as its depth (or as soon as all lanes are at a leaf).
+ *
+ * The kernels are compiled for their instruction set through target attributes and selected at run time, such that
+ * the benchmarks run on any x86-64 machine without special compiler flags.
+ */
+
+enum flat_forest_kernel{ kForestScalar, kForestAVX2, kForestAVX512, kForestAuto };
+
+const char* flat_forest_kernel_name(flat_forest_kernel kernel){
+    switch(kernel){
+        case kForestScalar: return "scalar";
+        case kForestAVX2: return "AVX2";
+        case kForestAVX512: return "AVX-512";
+        default: return "auto";
+    }
+}
+
+// Whether the given kernel can run on this machine.
+bool flat_forest_kernel_supported(flat_forest_kernel kernel){
+#ifdef BDTBENCH_FOREST_SIMD
+    switch(kernel){
+        case kForestAVX2: return __builtin_cpu_supports("avx2");
+        case kForestAVX512: return __builtin_cpu_supports("avx512f");
+        default: return true;
+    }
+#else
+    return kernel == kForestScalar || kernel == kForestAuto;
+#endif
+}
+
+// The widest kernel supported by this machine.
+flat_forest_kernel flat_forest_best_kernel(){
+    if(flat_forest_kernel_supported(kForestAVX512)){ return kForestAVX512; }
+    if(flat_forest_kernel_supported(kForestAVX2)){ return kForestAVX2; }
+    return kForestScalar;
+}
+
+#ifdef BDTBENCH_FOREST_SIMD
+
+/* Adds the leaf values of all trees reached by the n (at most flat_forest_block_size) row-major events starting at
+ * rows, row_stride values apart, to margins. Lanes past n are run on the last event and discarded.
+ */
+__attribute__((target("avx2")))
+void flat_forest_block_avx2(const flat_forest& forest, const Float_t* rows, size_t row_stride, size_t n,
+                            Double_t* margins){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+
+    for(size_t g = 0; g < n; g += 8){
+        alignas(32) Int_t lane_offsets[8];
+        for(Int_t l = 0; l < 8; l++){ lane_offsets[l] = std::min<size_t>(g + l, n - 1) * row_stride; }
+        const __m256i offsets = _mm256_load_si256((const __m256i*) lane_offsets);
+
+        __m256d sum_lo = _mm256_setzero_pd(), sum_hi = _mm256_setzero_pd();
+        for(UInt_t t = 0; t < forest.n_trees; t++){
+            __m256i node = _mm256_set1_epi32(forest.roots[t]);
+            for(Int_t d = 0; d < forest.depths[t]; d++){
+                const __m256i feature = _mm256_i32gather_epi32(forest.feature, node, 4);
+                const __m256i leaf = _mm256_cmpgt_epi32(zero, feature);
+                if(_mm256_movemask_epi8(leaf) == -1){ break; }
+
+                // Leaves read the first feature of their event, their move being discarded below
+                const __m256i index = _mm256_add_epi32(offsets, _mm256_max_epi32(feature, zero));
+                const __m256 x = _mm256_i32gather_ps(rows, index, 4);
+                const __m256 threshold = _mm256_i32gather_ps(forest.threshold, node, 4);
+                const __m256i default_left = _mm256_and_si256(
+                    _mm256_i32gather_epi32((const Int_t*) forest.default_left, node, 1), byte_mask);
+
+                // Go right if x >= threshold, where missing values go right unless the default is left
+                const __m256 ge = _mm256_cmp_ps(x, threshold, _CMP_GE_OQ);
+                const __m256 nlt = _mm256_cmp_ps(x, threshold, _CMP_NLT_UQ);
+                const __m256 right = _mm256_blendv_ps(nlt, ge, _mm256_castsi256_ps(_mm256_cmpgt_epi32(default_left, zero)));
+
+                const __m256i child = _mm256_sub_epi32(_mm256_i32gather_epi32(forest.left, node, 4),
+                                                       _mm256_castps_si256(right));
+                node = _mm256_blendv_epi8(child, node, leaf);
+            }
+
+            const __m256 value = _mm256_i32gather_ps(forest.value, node, 4);
+            sum_lo = _mm256_add_pd(sum_lo, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+            sum_hi = _mm256_add_pd(sum_hi, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+        }
+
+        alignas(32) Double_t sums[8];
+        _mm256_store_pd(sums, sum_lo);
+        _mm256_store_pd(sums + 4, sum_hi);
+        for(size_t l = 0; l < 8 && g + l < n; l++){ margins[g + l] += sums[l]; }
+    }
+}
+
+// AVX-512 variant of flat_forest_block_avx2, with 16 lanes and mask registers in place of blends.
+__attribute__((target("avx512f")))
+void flat_forest_block_avx512(const flat_forest& forest, const Float_t* rows, size_t row_stride, size_t n,
+                              Double_t* margins){
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i byte_mask = _mm512_set1_epi32(0xFF);
+
+    for(size_t g = 0; g < n; g += 16){
+        alignas(64) Int_t lane_offsets[16];
+        for(Int_t l = 0; l < 16; l++){ lane_offsets[l] = std::min<size_t>(g + l, n - 1) * row_stride; }
+        const __m512i offsets = _mm512_load_si512(lane_offsets);
+
+        __m512d sum_lo = _mm512_setzero_pd(), sum_hi = _mm512_setzero_pd();
+        for(UInt_t t = 0; t < forest.n_trees; t++){
+            __m512i node = _mm512_set1_epi32(forest.roots[t]);
+            for(Int_t d = 0; d < forest.depths[t]; d++){
+                const __m512i feature = _mm512_i32gather_epi32(node, forest.feature, 4);
+                const __mmask16 inner = _mm512_cmpge_epi32_mask(feature, zero);
+                if(!inner){ break; }
+
+                const __m512 x = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), inner,
+                                                          _mm512_add_epi32(offsets, feature), rows, 4);
+                const __m512 threshold = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), inner, node,
+                                                                  forest.threshold, 4);
+                const __m512i default_left = _mm512_and_si512(
+                    _mm512_mask_i32gather_epi32(zero, inner, node, forest.default_left, 1), byte_mask);
+                const __mmask16 dl = _mm512_test_epi32_mask(default_left, default_left);
+
+                // Go right if x >= threshold, where missing values go right unless the default is left
+                const __mmask16 ge = _mm512_cmp_ps_mask(x, threshold, _CMP_GE_OQ);
+                const __mmask16 nlt = _mm512_cmp_ps_mask(x, threshold, _CMP_NLT_UQ);
+                const __mmask16 right = (dl & ge) | (~dl & nlt);
+
+                const __m512i left = _mm512_mask_i32gather_epi32(node, inner, node, forest.left, 4);
+                node = _mm512_mask_mov_epi32(node, inner, _mm512_mask_add_epi32(left, right, left, one));
+            }
+
+            const __m512 value = _mm512_i32gather_ps(node, forest.value, 4);
+            sum_lo = _mm512_add_pd(sum_lo, _mm512_cvtps_pd(_mm512_castps512_ps256(value)));
+            sum_hi = _mm512_add_pd(sum_hi, _mm512_cvtps_pd(
+                _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(value), 1))));
+        }
+
+        alignas(64) Double_t sums[16];
+        _mm512_store_pd(sums, sum_lo);
+        _mm512_store_pd(sums + 8, sum_hi);
+        for(size_t l = 0; l < 16 && g + l < n; l++){ margins[g + l] += sums[l]; }
+    }
+}
+
+#endif
+
+/* Output of the forest for the events [begin, end) of a data set laid out as for flat_forest::PredictRange, using the
+ * given SIMD kernel. Blocks of events which are not row-major are first copied into a row-major buffer, such that the
+ * gather offsets stay small whatever the size of the data set.
+ */
+void flat_forest_predict_range_simd(const flat_forest& forest, const Float_t* data, size_t begin, size_t end,
+                                    size_t row_stride, size_t feature_stride, Float_t* out, flat_forest_kernel kernel){
+#ifdef BDTBENCH_FOREST_SIMD
+    const bool row_major = (feature_stride == 1);
+    std::vector<Float_t> rows(row_major ? 0 : flat_forest_block_size * forest.n_features);
+    Double_t margins[flat_forest_block_size];
+
+    for(size_t block = begin; block < end; block += flat_forest_block_size){
+        const size_t n = std::min(flat_forest_block_size, end - block);
+
+        const Float_t* block_rows = data + block * row_stride;
+        size_t block_row_stride = row_stride;
+        if(!row_major){
+            for(UInt_t j = 0; j < forest.n_features; j++){
+                for(size_t i = 0; i < n; i++){
+                    rows[i * forest.n_features + j] = data[(block + i) * row_stride + j * feature_stride];
+                }
+            }
+            block_rows = rows.data();
+            block_row_stride = forest.n_features;
+        }
+
+        std::fill(margins, margins + n, forest.base_score);
+        if(kernel == kForestAVX512){
+            flat_forest_block_avx512(forest, block_rows, block_row_stride, n, margins);
+        }else{
+            flat_forest_block_avx2(forest, block_rows, block_row_stride, n, margins);
+        }
+
+        for(size_t i = 0; i < n; i++){ out[block + i] = forest.Transform(margins[i]); }
+    }
+#else
+    forest.PredictRange(data, begin, end, row_stride, feature_stride, out);
+#endif
+}
+
+/* Output of the forest for all n_events events of a data set (see flat_forest::Predict), scored by n_threads threads
+ * with the given kernel (kForestAuto selecting the widest kernel supported). Throws if the kernel is not supported.
+ */
+void flat_forest_predict(const flat_forest& forest, const Float_t* data, size_t n_events, size_t row_stride,
+                         size_t feature_stride, Float_t* out, flat_forest_kernel kernel = kForestAuto,
+                         UInt_t n_threads = 1){
+    if(kernel == kForestAuto){ kernel = flat_forest_best_kernel(); }
+    if(!flat_forest_kernel_supported(kernel)){
+        throw std::runtime_error(std::string("Flat forest kernel not supported: ") + flat_forest_kernel_name(kernel));
+    }
+
+    if(kernel == kForestScalar){
+        forest.Predict(data, n_events, row_stride, feature_stride, out, n_threads);
+        return;
+    }
+
+    flat_forest_foreach_task(n_events, n_threads, [&](size_t begin, size_t end){
+        flat_forest_predict_range_simd(forest, data, begin, end, row_stride, feature_stride, out, kernel);
+    });
+}
+
+#endif //BDTBENCH_FLATFORESTSIMD_H
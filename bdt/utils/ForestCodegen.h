@@ -0,0 +1,214 @@
+#ifndef BDTBENCH_FORESTCODEGEN_H
+#define BDTBENCH_FORESTCODEGEN_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include "TInterpreter.h"
+#include "rootbench/RBConfig.h"
+
+#include "ContentHash.h"
+#include "FlatForest.h"
+
+/* Ahead-of-time compilation of a flat_forest into a shared library (in the spirit of treelite): each tree becomes a
+ * function made of nested if/else statements with the thresholds and leaf values as literals, and the forest becomes
+ * an extern "C" function summing them up, which is compiled with the compiler rootbench was built with (see
+ * RB::GetCXXCompiler) and loaded with dlopen.
+ *
+ * Alternatively, the same source can be JIT-compiled by Cling through gInterpreter (see JITForest), which avoids
+ * shipping a compiler or prebuilt libraries, at the price of the JIT latency at job start.
+ *
+ * Thresholds and leaf values are emitted as hexadecimal float literals, such that the compiled forest reproduces the
+ * flat forest exactly.
+ */
+
+// Signature of the function exported by a compiled forest, with the data laid out as for flat_forest::Predict.
+typedef void (*compiled_forest_fn)(const Float_t* data, size_t n_events, size_t row_stride, size_t feature_stride,
+                                   Float_t* out);
+
+const char compiled_forest_symbol[] = "bdt_forest_predict";
+
+// Exact C++ literal for the given value, as a float (with suffix) or as a double.
+std::string forest_codegen_literal(Double_t v, bool as_float){
+    if(std::isinf(v)){ return v > 0 ? "INFINITY" : "-INFINITY"; }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%a%s", v, as_float ? "f" : "");
+    return buf;
+}
+
+void forest_codegen_node(const flat_forest& forest, Int_t node, Int_t depth, std::ostream& out){
+    const std::string indent(4 * depth, ' ');
+    if(forest.feature[node] < 0){
+        out << indent << "return " << forest_codegen_literal(forest.value[node], true) << ";\n";
+        return;
+    }
+
+    // Left iff x < threshold, where missing values fail both tests and hence follow the default direction
+    const std::string x = "x[" + std::to_string(forest.feature[node]) + " * fs]";
+    const std::string threshold = forest_codegen_literal(forest.threshold[node], true);
+    if(forest.default_left[node]){
+        out << indent << "if(!(" << x << " >= " << threshold << ")){\n";
+    }else{
+        out << indent << "if(" << x << " < " << threshold << "){\n";
+    }
+    forest_codegen_node(forest, forest.left[node], depth + 1, out);
+    out << indent << "}else{\n";
+    forest_codegen_node(forest, forest.left[node] + 1, depth + 1, out);
+    out << indent << "}\n";
+}
+
+/* C++ source of the given forest, exporting the function name with the compiled_forest_fn signature (the functions of
+ * the trees being prefixed with name as well, such that several forests can be declared in the same interpreter).
+ */
+std::string forest_codegen_source(const flat_forest& forest, const std::string& name = compiled_forest_symbol){
+    std::ostringstream out;
+    out << "// Generated from a flat_forest of " << forest.n_trees << " trees (" << forest.n_nodes << " nodes)\n";
+    out << "#include <cmath>\n#include <cstddef>\n\n";
+
+    for(UInt_t t = 0; t < forest.n_trees; t++){
+        out << "static inline float " << name << "_tree_" << t << "(const float* x, std::size_t fs){\n";
+        forest_codegen_node(forest, forest.roots[t], 1, out);
+        out << "}\n\n";
+    }
+
+    out << "extern \"C\" void " << name << "(const float* data, std::size_t n_events, "
+        << "std::size_t row_stride, std::size_t fs, float* out){\n";
+    out << "    for(std::size_t i = 0; i < n_events; i++){\n";
+    out << "        const float* x = data + i * row_stride;\n";
+    out << "        double margin = " << forest_codegen_literal(forest.base_score, false) << ";\n";
+    for(UInt_t t = 0; t < forest.n_trees; t++){
+        out << "        margin += " << name << "_tree_" << t << "(x, fs);\n";
+    }
+    switch(forest.transform){
+        case kForestSigmoid: out << "        out[i] = 1.0 / (1.0 + std::exp(-margin));\n"; break;
+        case kForestTMVAGrad: out << "        out[i] = 2.0 / (1.0 + std::exp(-2.0 * margin)) - 1.0;\n"; break;
+        default: out << "        out[i] = margin;\n";
+    }
+    out << "    }\n}\n";
+
+    return out.str();
+}
+
+typedef struct compiled_forest{
+    void* handle = nullptr;      // dlopen handle, if compiled ahead of time
+    compiled_forest_fn predict = nullptr;
+
+    size_t source_size = 0;      // size of the generated C++ source, in bytes
+    size_t library_size = 0;     // size of the compiled shared library, in bytes
+    Double_t codegen_time = 0.0; // time spent generating the source, in seconds
+    Double_t compile_time = 0.0; // time spent compiling and loading the library (or JIT-compiling), in seconds
+
+    void free(){
+        if(handle){ dlclose(handle); }
+        handle = nullptr;
+        predict = nullptr;
+    }
+
+    // Output of the model for all n_events events of a data set (see flat_forest::Predict), scored by n_threads threads.
+    void Predict(const Float_t* data, size_t n_events, size_t row_stride, size_t feature_stride, Float_t* out,
+                 UInt_t n_threads = 1) const{
+        flat_forest_foreach_task(n_events, n_threads, [&](size_t begin, size_t end){
+            predict(data + begin * row_stride, end - begin, row_stride, feature_stride, out + begin);
+        });
+    }
+} compiled_forest;
+
+/* Generates, compiles and loads the given forest, writing the source to <prefix>.cxx and the library to <prefix>.so
+ * (the compiler output going to <prefix>.log). Throws if the compilation or the loading fails.
+ */
+compiled_forest* CompileForest(const flat_forest& forest, const std::string& prefix, const std::string& flags = "-O2"){
+    auto compiled = new compiled_forest();
+    const std::string source_path = prefix + ".cxx";
+    const std::string library_path = (prefix.find('/') == std::string::npos ? "./" : "") + prefix + ".so";
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        const std::string source = forest_codegen_source(forest);
+        std::ofstream out(source_path);
+        out << source;
+        compiled->source_size = source.size();
+    }
+    std::chrono::duration<Double_t> codegen_time = std::chrono::steady_clock::now() - start;
+    compiled->codegen_time = codegen_time.count();
+
+    start = std::chrono::steady_clock::now();
+    const std::string command = RB::GetCXXCompiler() + " " + flags + " -shared -fPIC -o " + library_path + " " +
+                                source_path + " > " + prefix + ".log 2>&1";
+    if(std::system(command.c_str()) != 0){
+        delete compiled;
+        throw std::runtime_error("Failed to compile forest (see " + prefix + ".log): " + command);
+    }
+
+    compiled->handle = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(!compiled->handle){
+        delete compiled;
+        throw std::runtime_error(std::string("Failed to load compiled forest: ") + dlerror());
+    }
+    compiled->predict = (compiled_forest_fn) dlsym(compiled->handle, compiled_forest_symbol);
+    std::chrono::duration<Double_t> compile_time = std::chrono::steady_clock::now() - start;
+    compiled->compile_time = compile_time.count();
+
+    if(!compiled->predict){
+        compiled->free();
+        delete compiled;
+        throw std::runtime_error("Compiled forest does not export " + std::string(compiled_forest_symbol));
+    }
+
+    struct stat st;
+    if(stat(library_path.c_str(), &st) == 0){ compiled->library_size = st.st_size; }
+
+    return compiled;
+}
+
+/* JIT-compiles the given forest with Cling (at optimisation level 2), returning it once its entry point has been
+ * resolved, which is when Cling emits the code. Forests are declared under names derived from the content hash of their
+ * source, and stay in the interpreter for the lifetime of the process: each forest is hence declared once per process,
+ * later calls for the same forest returning the function declared by the first one (along with its codegen and JIT
+ * times). Throws if the declaration or the symbol lookup fails.
+ */
+compiled_forest* JITForest(const flat_forest& forest){
+    static std::map<ULong64_t, compiled_forest> jit_forests;
+
+    const std::string generic_source = forest_codegen_source(forest, "bdt_forest_jit");
+    const ULong64_t hash = content_hash(generic_source.data(), generic_source.size());
+    auto cached = jit_forests.find(hash);
+    if(cached != jit_forests.end()){ return new compiled_forest(cached->second); }
+
+    const std::string name = "bdt_forest_jit_" + content_hash_str(hash);
+    auto compiled = new compiled_forest();
+    auto start = std::chrono::steady_clock::now();
+    const std::string source = "#pragma cling optimize(2)\n" + forest_codegen_source(forest, name);
+    compiled->source_size = source.size();
+    std::chrono::duration<Double_t> codegen_time = std::chrono::steady_clock::now() - start;
+    compiled->codegen_time = codegen_time.count();
+
+    start = std::chrono::steady_clock::now();
+    if(!gInterpreter->Declare(source.c_str())){
+        delete compiled;
+        throw std::runtime_error("Failed to declare forest " + name + " to the interpreter.");
+    }
+
+    TInterpreter::EErrorCode error = TInterpreter::kNoError;
+    compiled->predict = (compiled_forest_fn) gInterpreter->Calc(("(long) &" + name).c_str(), &error);
+    std::chrono::duration<Double_t> compile_time = std::chrono::steady_clock::now() - start;
+    compiled->compile_time = compile_time.count();
+
+    if(error != TInterpreter::kNoError || !compiled->predict){
+        delete compiled;
+        throw std::runtime_error("Failed to JIT-compile forest " + name + ".");
+    }
+
+    jit_forests[hash] = *compiled;
+    return compiled;
+}
+
+#endif //BDTBENCH_FORESTCODEGEN_H
@@ -0,0 +1,278 @@
+#ifndef BDTBENCH_FORESTCONVERT_H
+#define BDTBENCH_FORESTCONVERT_H
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "RVersion.h"
+#include "TMVA/Version.h"
+#include "TXMLEngine.h"
+
+#include "FlatForest.h"
+
+/* Conversion of flat forests into XGBoost JSON models and TMVA BDT weight files, such that one and the same trained
+ * forest can be scored by RReader, XGBoost and the native backends (TMVA -> XGBoost: TMVAToFlatForest followed by
+ * WriteXGBoostJSON; XGBoost -> TMVA: XGBoostToFlatForest followed by WriteTMVAWeights).
+ *
+ * The output of the converted model is that of the forest up to the transformations which the target framework cannot
+ * express:
+ *  - XGBoost: identity forests become reg:squarederror models, with the same output. Sigmoid forests become
+ *    binary:logistic models, with the same output. TMVA gradient boosted forests become binary:logistic models with
+ *    doubled leaf values, whose output p relates to the TMVA output y by p = (y + 1) / 2.
+ *  - TMVA: identity forests become AdaBoost BDTs scored by leaf purity (UseYesNoLeaf=False) with unit boost weights,
+ *    with the same output. Sigmoid and TMVA gradient boosted forests become gradient boosted BDTs (Grad), with halved
+ *    leaf responses for sigmoid forests, such that the TMVA output y relates to the probability p by y = 2 p - 1.
+ *    TMVA sends missing values to the left child of every node, whatever the default direction of the forest.
+ *
+ * Thresholds and leaf values are written with enough digits to be read back exactly as floats, and the base score is
+ * folded into the leaves where the target has no room for it.
+ */
+
+// Decimal representation of a float, with enough significant digits to read back as the same float.
+std::string forest_convert_float(Float_t v){
+    if(!std::isfinite(v)){ throw std::runtime_error("Cannot convert a forest with non-finite thresholds or values."); }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    return buf;
+}
+
+/* Output y of a model with the given transform on the scale shared by a forest and its conversions, i.e. the output
+ * itself, except for TMVA gradient boosting whose output is mapped onto the probability (y + 1) / 2.
+ */
+Double_t forest_common_output(flat_forest_transform transform, Double_t y){
+    return (transform == kForestTMVAGrad) ? (y + 1.0) / 2.0 : y;
+}
+
+/* XGBoost JSON model (as written by XGBoosterSaveModel to a .json file) of the given forest, with the node arrays of
+ * each tree in the breadth-first order of the flat forest.
+ */
+std::string forest_to_xgboost_json(const flat_forest& forest){
+    std::string objective = "reg:squarederror";
+    Double_t leaf_scale = 1.0, base_score = forest.base_score;
+    if(forest.transform != kForestIdentity){
+        objective = "binary:logistic";
+        leaf_scale = (forest.transform == kForestTMVAGrad) ? 2.0 : 1.0;
+        base_score = 1.0 / (1.0 + std::exp(-leaf_scale * forest.base_score));
+    }
+
+    const std::string n_features = "\"" + std::to_string(forest.n_features) + "\"";
+    std::ostringstream out;
+    out << "{\"learner\":{\"attributes\":{},\"feature_names\":[],\"feature_types\":[],\"gradient_booster\":{\"model\":{"
+        << "\"gbtree_model_param\":{\"num_parallel_tree\":\"1\",\"num_trees\":\"" << forest.n_trees
+        << "\",\"size_leaf_vector\":\"0\"},\"iteration_indptr\":[";
+    for(UInt_t t = 0; t <= forest.n_trees; t++){ out << (t ? "," : "") << t; }
+    out << "],\"tree_info\":[";
+    for(UInt_t t = 0; t < forest.n_trees; t++){ out << (t ? "," : "") << 0; }
+    out << "],\"trees\":[";
+
+    for(UInt_t t = 0; t < forest.n_trees; t++){
+        const Int_t root = forest.roots[t];
+        const Int_t end = (t + 1 < forest.n_trees) ? forest.roots[t + 1] : forest.n_nodes;
+        const Int_t n_nodes = end - root;
+
+        // Tree-local node ids, the root's parent being XGBoost's invalid node id (with the left-child bit cleared)
+        std::vector<Int_t> parents(n_nodes, 2147483647);
+        for(Int_t k = root; k < end; k++){
+            if(forest.feature[k] >= 0){
+                parents[forest.left[k] - root] = parents[forest.left[k] + 1 - root] = k - root;
+            }
+        }
+
+        std::ostringstream lefts, rights, indices, conditions, weights, default_lefts, zeros;
+        for(Int_t k = root; k < end; k++){
+            const bool leaf = forest.feature[k] < 0;
+            const char* sep = (k > root) ? "," : "";
+            const Float_t value = (Float_t) (leaf_scale * forest.value[k]);
+            lefts << sep << (leaf ? -1 : forest.left[k] - root);
+            rights << sep << (leaf ? -1 : forest.left[k] + 1 - root);
+            indices << sep << (leaf ? 0 : forest.feature[k]);
+            conditions << sep << forest_convert_float(leaf ? value : forest.threshold[k]);
+            weights << sep << forest_convert_float(leaf ? value : 0.0f);
+            default_lefts << sep << (forest.default_left[k] ? "true" : "false");
+            zeros << sep << 0;
+        }
+
+        std::string parents_list;
+        for(Int_t k = 0; k < n_nodes; k++){ parents_list += (k ? "," : "") + std::to_string(parents[k]); }
+
+        out << (t ? "," : "") << "{\"base_weights\":[" << weights.str() << "],\"categories\":[],"
+            << "\"categories_nodes\":[],\"categories_segments\":[],\"categories_sizes\":[],"
+            << "\"default_left\":[" << default_lefts.str() << "],\"id\":" << t << ","
+            << "\"left_children\":[" << lefts.str() << "],\"loss_changes\":[" << zeros.str() << "],"
+            << "\"parents\":[" << parents_list << "],\"right_children\":[" << rights.str() << "],"
+            << "\"split_conditions\":[" << conditions.str() << "],\"split_indices\":[" << indices.str() << "],"
+            << "\"split_type\":[" << zeros.str() << "],\"sum_hessian\":[" << zeros.str() << "],"
+            << "\"tree_param\":{\"num_deleted\":\"0\",\"num_feature\":" << n_features << ",\"num_nodes\":\""
+            << n_nodes << "\",\"size_leaf_vector\":\"0\"}}";
+    }
+
+    char base_score_str[32];
+    snprintf(base_score_str, sizeof(base_score_str), "%.9g", base_score);
+    out << "]},\"name\":\"gbtree\"},\"learner_model_param\":{\"base_score\":\"" << base_score_str
+        << "\",\"boost_from_average\":\"1\",\"num_class\":\"0\",\"num_feature\":" << n_features
+        << ",\"num_target\":\"1\"},\"objective\":{\"name\":\"" << objective
+        << "\",\"reg_loss_param\":{\"scale_pos_weight\":\"1\"}}},\"version\":[1,6,0]}";
+
+    return out.str();
+}
+
+// Writes the forest as an XGBoost JSON model file (see forest_to_xgboost_json). Throws if the file cannot be written.
+void WriteXGBoostJSON(const flat_forest& forest, const std::string& path){
+    std::ofstream out(path, std::ios::binary);
+    out << forest_to_xgboost_json(forest);
+    if(!out){ throw std::runtime_error("Failed to write XGBoost model " + path); }
+}
+
+/* Appends the subtree of the flat forest rooted at node to the given TMVA tree XML node, as a DecisionTreeNode at
+ * position pos ('s' for the root, 'l' or 'r'), with leaf responses (Grad) or purities (AdaBoost) of
+ * leaf_scale * value + leaf_offset.
+ */
+void write_tmva_node(TXMLEngine& xml, XMLNodePointer_t parent, const flat_forest& forest, Int_t node, Int_t depth,
+                     const char* pos, bool grad, Double_t leaf_scale, Double_t leaf_offset){
+    const bool leaf = forest.feature[node] < 0;
+    const Double_t leaf_value = leaf_scale * forest.value[node] + leaf_offset;
+    char value[32];
+    snprintf(value, sizeof(value), "%.9g", leaf ? leaf_value : (grad ? 0.0 : 0.5));
+
+    XMLNodePointer_t xml_node = xml.NewChild(parent, nullptr, "Node");
+    xml.NewAttr(xml_node, nullptr, "pos", pos);
+    xml.NewIntAttr(xml_node, "depth", depth);
+    xml.NewIntAttr(xml_node, "NCoef", 0);
+    xml.NewIntAttr(xml_node, "IVar", leaf ? -1 : forest.feature[node]);
+    xml.NewAttr(xml_node, nullptr, "Cut", forest_convert_float(leaf ? 0.0f : forest.threshold[node]).c_str());
+    xml.NewIntAttr(xml_node, "cType", 1);
+    xml.NewAttr(xml_node, nullptr, "res", grad ? value : "0");
+    xml.NewAttr(xml_node, nullptr, "rms", "0");
+    xml.NewAttr(xml_node, nullptr, "purity", grad ? "0.5" : value);
+
+    // Leaves are of node type 1 (signal) or -1 (background), which only matters for UseYesNoLeaf
+    xml.NewIntAttr(xml_node, "nType", leaf ? (leaf_value >= (grad ? 0.0 : 0.5) ? 1 : -1) : 0);
+    if(leaf){ return; }
+
+    write_tmva_node(xml, xml_node, forest, forest.left[node], depth + 1, "l", grad, leaf_scale, leaf_offset);
+    write_tmva_node(xml, xml_node, forest, forest.left[node] + 1, depth + 1, "r", grad, leaf_scale, leaf_offset);
+}
+
+/* Writes the forest as a TMVA BDT classifier weights file (see above), which can be booked by RReader or TMVA::Reader
+ * with the given input variable names (var0, var1, ... by default, as in MakeRandomTTree.h). Throws if the forest has
+ * no trees, or if the file cannot be written.
+ */
+void WriteTMVAWeights(const flat_forest& forest, const std::string& path, std::vector<std::string> variables = {}){
+    if(forest.n_trees == 0){ throw std::runtime_error("Cannot convert a forest without trees to TMVA."); }
+    for(UInt_t j = variables.size(); j < forest.n_features; j++){ variables.push_back("var" + std::to_string(j)); }
+
+    // Gradient boosting responses are summed (and folded with the base score into the first tree); AdaBoost purities
+    // are averaged over the trees, so each tree carries n_trees times its share, plus the base score
+    const bool grad = (forest.transform != kForestIdentity);
+    const Double_t leaf_scale = grad ? (forest.transform == kForestSigmoid ? 0.5 : 1.0) : forest.n_trees;
+    const Double_t base_offset = grad ? leaf_scale * forest.base_score : forest.base_score;
+
+    TXMLEngine xml;
+    XMLDocPointer_t doc = xml.NewDoc();
+    XMLNodePointer_t setup = xml.NewChild(nullptr, nullptr, "MethodSetup");
+    xml.NewAttr(setup, nullptr, "Method", "BDT::BDT");
+    xml.DocSetRootElement(doc, setup);
+
+    XMLNodePointer_t info = xml.NewChild(setup, nullptr, "GeneralInfo");
+    const std::vector<std::pair<std::string, std::string>> infos = {
+        {"TMVA Release", std::string(TMVA_RELEASE) + " [" + std::to_string(TMVA_VERSION_CODE) + "]"},
+        {"ROOT Release", std::string(ROOT_RELEASE) + " [" + std::to_string(ROOT_VERSION_CODE) + "]"},
+        {"Creator", "rootbench"},
+        {"AnalysisType", "Classification"}};
+    for(auto& item: infos){
+        XMLNodePointer_t node = xml.NewChild(info, nullptr, "Info");
+        xml.NewAttr(node, nullptr, "name", item.first.c_str());
+        xml.NewAttr(node, nullptr, "value", item.second.c_str());
+    }
+
+    XMLNodePointer_t options = xml.NewChild(setup, nullptr, "Options");
+    const std::vector<std::pair<std::string, std::string>> option_values = {
+        {"NTrees", std::to_string(forest.n_trees)},
+        {"MaxDepth", std::to_string(std::max<Int_t>(forest.max_depth, 1))},
+        {"BoostType", grad ? "Grad" : "AdaBoost"},
+        {"UseYesNoLeaf", "False"}};
+    for(auto& item: option_values){
+        XMLNodePointer_t node = xml.NewChild(options, nullptr, "Option", item.second.c_str());
+        xml.NewAttr(node, nullptr, "name", item.first.c_str());
+        xml.NewAttr(node, nullptr, "modified", "Yes");
+    }
+
+    XMLNodePointer_t vars = xml.NewChild(setup, nullptr, "Variables");
+    xml.NewIntAttr(vars, "NVar", forest.n_features);
+    for(UInt_t j = 0; j < forest.n_features; j++){
+        XMLNodePointer_t node = xml.NewChild(vars, nullptr, "Variable");
+        xml.NewIntAttr(node, "VarIndex", j);
+        for(const char* attr: {"Expression", "Label", "Title", "Internal"}){
+            xml.NewAttr(node, nullptr, attr, variables[j].c_str());
+        }
+        xml.NewAttr(node, nullptr, "Unit", "");
+        xml.NewAttr(node, nullptr, "Type", "F");
+        xml.NewAttr(node, nullptr, "Min", "0");
+        xml.NewAttr(node, nullptr, "Max", "0");
+    }
+    xml.NewIntAttr(xml.NewChild(setup, nullptr, "Spectators"), "NSpec", 0);
+
+    XMLNodePointer_t classes = xml.NewChild(setup, nullptr, "Classes");
+    xml.NewIntAttr(classes, "NClass", 2);
+    for(Int_t c = 0; c < 2; c++){
+        XMLNodePointer_t node = xml.NewChild(classes, nullptr, "Class");
+        xml.NewAttr(node, nullptr, "Name", c ? "Background" : "Signal");
+        xml.NewIntAttr(node, "Index", c);
+    }
+    xml.NewIntAttr(xml.NewChild(setup, nullptr, "Transformations"), "NTransformations", 0);
+    xml.NewChild(setup, nullptr, "MVAPdfs");
+
+    // Gradient boosted trees are regression trees to TMVA, scored by their leaf responses (DecisionTree::CheckEvent)
+    XMLNodePointer_t weights = xml.NewChild(setup, nullptr, "Weights");
+    xml.NewIntAttr(weights, "NTrees", forest.n_trees);
+    xml.NewIntAttr(weights, "AnalysisType", grad ? 1 : 0);
+    for(UInt_t t = 0; t < forest.n_trees; t++){
+        XMLNodePointer_t tree = xml.NewChild(weights, nullptr, "BinaryTree");
+        xml.NewAttr(tree, nullptr, "type", "DecisionTree");
+        xml.NewAttr(tree, nullptr, "boostWeight", "1");
+        xml.NewIntAttr(tree, "itree", t);
+        write_tmva_node(xml, tree, forest, forest.roots[t], 0, "s", grad, leaf_scale,
+                        (grad && t > 0) ? 0.0 : base_offset);
+    }
+
+    xml.SaveDoc(doc, path.c_str());
+    xml.FreeDoc(doc);
+
+    std::ifstream check(path);
+    if(!check){ throw std::runtime_error("Failed to write TMVA weights file " + path); }
+}
+
+// Converts the given TMVA BDT weights file into an XGBoost JSON model file.
+void TMVAToXGBoostJSON(const std::string& weights, const std::string& json_file){
+    flat_forest* forest = TMVAToFlatForest(weights);
+    try{
+        WriteXGBoostJSON(*forest, json_file);
+    }catch(...){
+        forest->free();
+        delete forest;
+        throw;
+    }
+    forest->free();
+    delete forest;
+}
+
+// Converts the given XGBoost JSON model file into a TMVA BDT weights file.
+void XGBoostJSONToTMVA(const std::string& json_file, const std::string& weights){
+    flat_forest* forest = XGBoostToFlatForest(json_file);
+    try{
+        WriteTMVAWeights(*forest, weights);
+    }catch(...){
+        forest->free();
+        delete forest;
+        throw;
+    }
+    forest->free();
+    delete forest;
+}
+
+#endif //BDTBENCH_FORESTCONVERT_H
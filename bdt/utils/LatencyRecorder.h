@@ -0,0 +1,58 @@
+#ifndef BDTBENCH_LATENCYRECORDER_H
+#define BDTBENCH_LATENCYRECORDER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+/* Records the latency of individual calls inside a benchmarking loop, and reports percentiles of their distribution
+ * as benchmark counters (in seconds, like the other time counters of the suite). Intended for calls which are too
+ * short to be timed by Google Benchmark on their own, i.e. one call per benchmark iteration:
+ *
+ *    latency_recorder latencies;
+ *    latencies.Reserve(state.max_iterations);
+ *    for(auto _: state){
+ *       auto start = latencies.Start();
+ *       ...
+ *       latencies.Stop(start);
+ *    }
+ *    latencies.Report(state);
+ */
+typedef struct latency_recorder{
+    typedef std::chrono::steady_clock clock;
+
+    std::vector<Double_t> samples; // latencies, in seconds
+
+    // Reserves room for n samples, such that recording does not reallocate inside the timed region.
+    void Reserve(size_t n){ samples.reserve(n); }
+
+    clock::time_point Start() const{ return clock::now(); }
+
+    void Stop(clock::time_point start){
+        std::chrono::duration<Double_t> latency = clock::now() - start;
+        samples.push_back(latency.count());
+    }
+
+    // Nearest-rank percentile of the recorded latencies, with p in [0, 100].
+    Double_t Percentile(Double_t p){
+        if(samples.empty()){ return 0.0; }
+        std::sort(samples.begin(), samples.end());
+        size_t rank = (size_t) std::ceil(p / 100.0 * samples.size());
+        return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    // Sets the p50, p90, p99 and p99.9 latencies (and the maximum) as counters of the given benchmark state.
+    void Report(benchmark::State& state){
+        for(Double_t p: {50.0, 90.0, 99.0, 99.9}){
+            std::string name = "p" + std::string(p == 99.9 ? "99.9" : std::to_string((int) p)) + " Latency";
+            state.counters[name] = Percentile(p);
+        }
+        state.counters["Max Latency"] = Percentile(100.0);
+    }
+} latency_recorder;
+
+#endif //BDTBENCH_LATENCYRECORDER_H
@@ -0,0 +1,166 @@
+#ifndef BDTBENCH_MAKEHEPLIKETTREE_H
+#define BDTBENCH_MAKEHEPLIKETTREE_H
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "MakeRandomTTree.h"
+
+/* Parameters of the HEP-like synthetic samples generated by genHEPTree. Unlike genTree, whose classes are independent
+ * Gaussians differing only by their mean (and which a depth-2 tree already separates), the samples combine:
+ * (i)   correlated variables, with a configurable covariance matrix;
+ * (ii)  a non-linear decision boundary, the signal being bent along pairs of variables ("banana" shapes);
+ * (iii) heavy tails, a fraction of the events being drawn from a multivariate Student-t rather than a Gaussian;
+ * (iv)  positive, skewed "momentum-like" variables (log-normal), as is typical of kinematic quantities; and
+ * (v)   a tunable class overlap, via the distance between the signal and background means.
+ */
+typedef struct hep_gen_opts{
+   // Distance between the signal and background means, in units of the standard deviation (0 for full overlap)
+   Double_t separation = 1.0;
+   // Correlation between variables i and j, used as Cov_ij = correlation^|i - j| unless a covariance is given
+   Double_t correlation = 0.4;
+   // Full (row-major, nVars x nVars) covariance matrix, overriding correlation if non-empty
+   std::vector<Double_t> covariance;
+   // Strength of the quadratic bending of the signal, which makes the optimal decision boundary non-linear
+   Double_t nonlinearity = 1.0;
+   // Fraction of the events drawn from the heavy-tailed distribution, and its (integer) number of degrees of freedom
+   Double_t tail_fraction = 0.05;
+   UInt_t tail_dof = 3;
+   // Fraction of the variables transformed into positive, skewed variables (the last ones of every group of four)
+   Double_t positive_fraction = 0.25;
+} hep_gen_opts;
+
+// Lower-triangular Cholesky factor (row-major, nVars x nVars) of the covariance matrix described by the options.
+std::vector<Double_t> hepCholesky(const hep_gen_opts& opts, const UInt_t nVars){
+   std::vector<Double_t> cov(opts.covariance);
+   if(cov.empty()){
+      cov.resize((size_t) nVars * nVars);
+      for(UInt_t i = 0; i < nVars; i++){
+         for(UInt_t j = 0; j < nVars; j++){
+            cov[(size_t) i * nVars + j] = std::pow(opts.correlation, std::abs((Int_t) i - (Int_t) j));
+         }
+      }
+   }else if(cov.size() != (size_t) nVars * nVars){
+      throw std::runtime_error("Covariance matrix of the HEP-like generator must be nVars x nVars.");
+   }
+
+   std::vector<Double_t> L((size_t) nVars * nVars, 0.0);
+   for(UInt_t i = 0; i < nVars; i++){
+      for(UInt_t j = 0; j <= i; j++){
+         Double_t sum = cov[(size_t) i * nVars + j];
+         for(UInt_t k = 0; k < j; k++){
+            sum -= L[(size_t) i * nVars + k] * L[(size_t) j * nVars + k];
+         }
+
+         if(i == j){
+            if(sum <= 0.0){ throw std::runtime_error("Covariance matrix of the HEP-like generator is not positive definite."); }
+            L[(size_t) i * nVars + i] = std::sqrt(sum);
+         }else{
+            L[(size_t) i * nVars + j] = sum / L[(size_t) j * nVars + j];
+         }
+      }
+   }
+
+   return L;
+}
+
+/* Utility function for generating HEP-like float data in parallel, for the specified number of points and vars, of
+ * either the signal or the background class. As for genColumnsMT, the events are generated in chunks of genChunkSize
+ * events seeded by genChunkSeed, such that the values are reproducible for a given seed whatever the number of threads.
+ *
+ * The values of event j for variable i are written to cols[i * stride + j].
+ */
+void genHEPColumns(Float_t* cols, size_t stride, UInt_t nPoints, const UInt_t nVars, bool signal,
+                   const hep_gen_opts& opts, UInt_t seed = 100, UInt_t nThreads = 0){
+   const std::vector<Double_t> L = hepCholesky(opts, nVars);
+   const Double_t shift = (signal ? 0.5 : -0.5) * opts.separation / std::sqrt((Double_t) nVars);
+
+   auto genChunk = [&](ULong_t chunk){
+      TRandom3 rng(genChunkSeed(seed, chunk));
+      std::vector<Double_t> z(nVars), x(nVars);
+
+      const UInt_t chunk_begin = chunk * genChunkSize;
+      const UInt_t chunk_end = std::min<ULong64_t>((ULong64_t) chunk_begin + genChunkSize, nPoints);
+      for(UInt_t j = chunk_begin; j < chunk_end; j++){
+         // Correlated Gaussian variables
+         for(UInt_t i = 0; i < nVars; i++){ z[i] = rng.Gaus(0.0, 1.0); }
+         for(UInt_t i = 0; i < nVars; i++){
+            x[i] = 0.0;
+            for(UInt_t k = 0; k <= i; k++){ x[i] += L[(size_t) i * nVars + k] * z[k]; }
+         }
+
+         // Non-linear boundary: the signal is bent along pairs of variables
+         if(signal){
+            for(UInt_t i = 0; i + 1 < nVars; i += 2){ x[i] += 0.5 * opts.nonlinearity * (x[i + 1] * x[i + 1] - 1.0); }
+         }
+
+         // Heavy tails: rescaling by sqrt(dof / chi2) turns the Gaussian core into a multivariate Student-t
+         Double_t t_scale = 1.0;
+         if(rng.Rndm() < opts.tail_fraction){
+            Double_t chi2 = 0.0;
+            for(UInt_t k = 0; k < opts.tail_dof; k++){ Double_t g = rng.Gaus(0.0, 1.0); chi2 += g * g; }
+            t_scale = std::sqrt(opts.tail_dof / std::max(chi2, 1e-12));
+         }
+
+         for(UInt_t i = 0; i < nVars; i++){
+            x[i] += shift;
+
+            // Positive, skewed variables: the last one of every group of four, up to the requested fraction of the
+            // variables; these are log-normal in the core, and get power-law tails from the rescaling below
+            if(i % 4 == 3 && (i / 4 + 1) <= opts.positive_fraction * nVars){ x[i] = std::exp(0.5 * x[i]); }
+
+            x[i] *= t_scale;
+            cols[i * stride + j] = x[i];
+         }
+      }
+   };
+
+   const ULong_t n_chunks = (nPoints + genChunkSize - 1) / genChunkSize;
+   if(nThreads == 1){
+      for(ULong_t chunk = 0; chunk < n_chunks; chunk++){ genChunk(chunk); }
+   }else{
+      ROOT::TThreadExecutor pool(nThreads);
+      pool.Foreach(genChunk, ROOT::TSeqUL(n_chunks));
+   }
+}
+
+// Utility function for generating a TTree with HEP-like float data (see hep_gen_opts), with the same branches as genTree
+TTree* genHEPTree(std::string name, UInt_t nPoints, const UInt_t nVars, bool signal, const hep_gen_opts& opts,
+                  UInt_t seed = 100, bool evtCol = true, UInt_t nThreads = 0){
+   // Generate the values of all the events upfront
+   std::vector<Float_t> cols((size_t) nPoints * nVars);
+   genHEPColumns(cols.data(), nPoints, nPoints, nVars, signal, opts, seed, nThreads);
+
+   // Initialisation
+   std::vector<Float_t> vars(nVars, 0.0);
+   UInt_t id = 0;
+
+   // Create new TTree instance, with a branch corresponding to each variable and to the (unique) Event identifier
+   auto data = new TTree(name.c_str(),name.c_str());
+   for(UInt_t i = 0; i < nVars; i++){
+      std::string var_name = "var" + std::to_string(i);
+      std::string var_leaflist = var_name + "/F";
+
+      data->Branch(var_name.c_str(), vars.data() + i, var_leaflist.c_str());
+   }
+   if(evtCol){
+      data->Branch("EventNumber", &id, "EventNumber/I");
+   }
+
+   // Populate TTree instance with the generated data
+   for(UInt_t j = 0; j < nPoints; j++){
+      for(UInt_t i = 0; i < nVars; i++){
+         vars[i] = cols[(size_t) i * nPoints + j];
+      }
+
+      data->Fill();
+      id++;
+   }
+
+   // Important: Disconnects the tree from the memory locations of vars[i]
+   data->ResetBranchAddresses();
+   return data;
+}
+
+#endif //BDTBENCH_MAKEHEPLIKETTREE_H
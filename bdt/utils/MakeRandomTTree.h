@@ -1,3 +1,12 @@
+#ifndef BDTBENCH_MAKERANDOMTTREE_H
+#define BDTBENCH_MAKERANDOMTTREE_H
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "ROOT/TSeq.hxx"
+#include "ROOT/TThreadExecutor.hxx"
 #include "TRandom3.h"
 #include "TTree.h"
 
@@ -38,4 +47,116 @@ TTree* genTree(std::string name, UInt_t nPoints, const UInt_t nVars, Double_t of
    // Important: Disconnects the tree from the memory locations of vars[i]
    data->ResetBranchAddresses();
    return data;
-}
\ No newline at end of file
+}
+
+// Number of events of each independently seeded chunk generated by genTreeMT
+const UInt_t genChunkSize = 1 << 16;
+
+// Seed of the given chunk, derived from the base seed via SplitMix64 (never 0, which TRandom3 takes as a random seed)
+UInt_t genChunkSeed(UInt_t seed, ULong64_t chunk){
+   ULong64_t z = ((ULong64_t) seed << 32) + chunk + 0x9E3779B97F4A7C15ULL;
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   z = z ^ (z >> 31);
+
+   UInt_t chunk_seed = (UInt_t) (z ^ (z >> 32));
+   return chunk_seed == 0 ? 1 : chunk_seed;
+}
+
+/* Utility function for generating Gaussian float data in parallel, for the specified number of points and vars. The
+ * events are split into chunks of genChunkSize events, each drawn from its own TRandom3 stream seeded by genChunkSeed,
+ * and the chunks are generated concurrently on the given pool (or serially if there is none). The values are hence
+ * reproducible for a given seed, independently of the number of threads.
+ *
+ * The values of event j for variable i are written to cols[i * stride + j], for the events [begin, end) of the chunks.
+ */
+void genColumnsMT(Float_t* cols, size_t stride, UInt_t begin, UInt_t end, const UInt_t nVars, Double_t offset,
+                  Double_t scale, UInt_t seed, ROOT::TThreadExecutor* pool){
+   auto genChunk = [&](ULong_t chunk){
+      TRandom3 rng(genChunkSeed(seed, chunk));
+      const UInt_t chunk_begin = chunk * genChunkSize;
+      const UInt_t chunk_end = std::min<ULong64_t>((ULong64_t) chunk_begin + genChunkSize, end);
+
+      for(UInt_t j = chunk_begin; j < chunk_end; j++){
+         for(UInt_t i = 0; i < nVars; i++){
+            cols[i * stride + (j - begin)] = rng.Gaus(offset, scale);
+         }
+      }
+   };
+
+   // begin must lie on a chunk boundary, such that the chunks (hence the seeds) do not depend on how events are batched
+   const ULong_t first_chunk = begin / genChunkSize;
+   const ULong_t last_chunk = (end + genChunkSize - 1) / genChunkSize;
+   if(pool == nullptr){
+      for(ULong_t chunk = first_chunk; chunk < last_chunk; chunk++){ genChunk(chunk); }
+   }else{
+      pool->Foreach(genChunk, ROOT::TSeqUL(first_chunk, last_chunk));
+   }
+}
+
+// As above, on a pool of nThreads threads (all the threads of the implicit multi-threading pool if 0).
+void genColumnsMT(Float_t* cols, size_t stride, UInt_t begin, UInt_t end, const UInt_t nVars, Double_t offset,
+                  Double_t scale = 0.3, UInt_t seed = 100, UInt_t nThreads = 0){
+   std::unique_ptr<ROOT::TThreadExecutor> pool(nThreads == 1 ? nullptr : new ROOT::TThreadExecutor(nThreads));
+   genColumnsMT(cols, stride, begin, end, nVars, offset, scale, seed, pool.get());
+}
+
+/* Parallel variant of genTree, with the values being generated by genColumnsMT; note that the values hence differ from
+ * the ones of genTree for the same seed. Events are generated in batches of a few chunks per thread of the pool (which
+ * is created once per TTree), which bounds the memory held besides the TTree itself, and are filled into the TTree in
+ * order. When the TTree is attached to a file, the baskets are flushed at the end of every chunk, such that each chunk
+ * is written as a separate cluster. For a given seed, the resulting TTree is bit-identical whatever the number of
+ * threads.
+ */
+TTree* genTreeMT(std::string name, UInt_t nPoints, const UInt_t nVars, Double_t offset, Double_t scale = 0.3,
+                 UInt_t seed = 100, bool evtCol = true, UInt_t nThreads = 0){
+   // Initialisation
+   std::unique_ptr<ROOT::TThreadExecutor> pool(nThreads == 1 ? nullptr : new ROOT::TThreadExecutor(nThreads));
+   const UInt_t batchChunks = 4 * (pool ? std::max(pool->GetPoolSize(), 1u) : 1u);
+   const UInt_t batchSize = batchChunks * genChunkSize;
+   std::vector<Float_t> cols((size_t) batchSize * nVars);
+   std::vector<Float_t> vars(nVars, 0.0);
+   UInt_t id = 0;
+
+   // Create new TTree instance
+   auto data = new TTree(name.c_str(),name.c_str());
+
+   // Add a branch corresponding to each variable
+   for(UInt_t i = 0; i < nVars; i++){
+      std::string var_name = "var" + std::to_string(i);
+      std::string var_leaflist = var_name + "/F";
+
+      data->Branch(var_name.c_str(), vars.data() + i, var_leaflist.c_str());
+   }
+
+   // And add a branch for the (unique) Event identifier
+   if(evtCol){
+      data->Branch("EventNumber", &id, "EventNumber/I");
+   }
+
+   // Populate TTree instance with Gaussian data, one batch of chunks at a time
+   for(UInt_t begin = 0; begin < nPoints; begin += std::min(batchSize, nPoints - begin)){
+      const UInt_t end = std::min<ULong64_t>((ULong64_t) begin + batchSize, nPoints);
+      genColumnsMT(cols.data(), batchSize, begin, end, nVars, offset, scale, seed, pool.get());
+
+      for(UInt_t j = begin; j < end; j++){
+         for(UInt_t i = 0; i < nVars; i++){
+            vars[i] = cols[(size_t) i * batchSize + (j - begin)];
+         }
+
+         data->Fill();
+         id++;
+
+         // Close the cluster at the end of every chunk
+         if((id % genChunkSize == 0 || id == nPoints) && data->GetCurrentFile() != nullptr){
+            data->FlushBaskets();
+         }
+      }
+   }
+
+   // Important: Disconnects the tree from the memory locations of vars[i]
+   data->ResetBranchAddresses();
+   return data;
+}
+
+#endif //BDTBENCH_MAKERANDOMTTREE_H
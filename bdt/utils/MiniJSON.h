@@ -0,0 +1,221 @@
+#ifndef BDTBENCH_MINIJSON_H
+#define BDTBENCH_MINIJSON_H
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Rtypes.h"
+
+/* Minimal, read-only JSON reader for model files (e.g. XGBoost's JSON model format), without depending on a JSON
+ * library. Parsing is lazy: a json_value only records the span of the value in the source text, such that large numeric
+ * arrays (the per-node arrays of a forest) are never materialised as individual values, but are converted straight into
+ * typed vectors by json_value::to_vector. The source text must hence outlive all the values referring to it.
+ */
+
+enum json_type{ kJSONNull, kJSONBool, kJSONNumber, kJSONString, kJSONArray, kJSONObject };
+
+// Skips any whitespace starting at p, returning the first non-whitespace character.
+const char* json_skip_ws(const char* p, const char* end){
+    while(p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')){ p++; }
+    return p;
+}
+
+// Skips the string literal starting at p (which must point to the opening quote), returning the end of the literal.
+const char* json_skip_string(const char* p, const char* end){
+    for(p++; p < end; p++){
+        if(*p == '\\'){ p++; }
+        else if(*p == '"'){ return p + 1; }
+    }
+    throw std::runtime_error("Unterminated JSON string.");
+}
+
+/* Skips the value starting at p, returning the end of the value. Nested arrays and objects are skipped by bracket
+ * matching only, their contents being validated once they are accessed.
+ */
+const char* json_skip_value(const char* p, const char* end){
+    if(p >= end){ throw std::runtime_error("Unexpected end of JSON text."); }
+
+    switch(*p){
+        case '"':
+            return json_skip_string(p, end);
+        case '{':
+        case '[':{
+            Int_t depth = 0;
+            while(p < end){
+                if(*p == '"'){ p = json_skip_string(p, end); continue; }
+                if(*p == '{' || *p == '['){ depth++; }
+                else if(*p == '}' || *p == ']'){ if(--depth == 0){ return p + 1; } }
+                p++;
+            }
+            throw std::runtime_error("Unterminated JSON array or object.");
+        }
+        default:{
+            const char* begin = p;
+            while(p < end && (isalnum(*p) || *p == '-' || *p == '+' || *p == '.')){ p++; }
+            if(p == begin){ throw std::runtime_error(std::string("Unexpected character in JSON text: ") + *p); }
+            return p;
+        }
+    }
+}
+
+// Number conversions used by json_value::to_vector, dispatched on the element type.
+inline void json_to_number(const char* p, char** e, Float_t& v){ v = strtof(p, e); }
+inline void json_to_number(const char* p, char** e, Double_t& v){ v = strtod(p, e); }
+inline void json_to_number(const char* p, char** e, Int_t& v){ v = (Int_t) strtol(p, e, 10); }
+inline void json_to_number(const char* p, char** e, Long64_t& v){ v = strtoll(p, e, 10); }
+inline void json_to_number(const char* p, char** e, UChar_t& v){ v = (UChar_t) strtol(p, e, 10); }
+
+typedef struct json_value{
+    json_type type = kJSONNull;
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    json_value() = default;
+
+    json_value(const char* b, const char* e) : begin(b), end(e){
+        switch(*b){
+            case '{': type = kJSONObject; break;
+            case '[': type = kJSONArray; break;
+            case '"': type = kJSONString; break;
+            case 't':
+            case 'f': type = kJSONBool; break;
+            case 'n': type = kJSONNull; break;
+            default: type = kJSONNumber;
+        }
+    }
+
+    // Key and value of each member of an object, in document order.
+    std::vector<std::pair<std::string, json_value>> members() const{
+        if(type != kJSONObject){ throw std::runtime_error("JSON value is not an object."); }
+
+        std::vector<std::pair<std::string, json_value>> out;
+        const char* p = json_skip_ws(begin + 1, end);
+        if(*p == '}'){ return out; }
+        while(true){
+            if(*p != '"'){ throw std::runtime_error("Expected a key in JSON object."); }
+            const char* key_end = json_skip_string(p, end);
+            json_value key(p, key_end);
+
+            p = json_skip_ws(key_end, end);
+            if(*p != ':'){ throw std::runtime_error("Expected ':' in JSON object."); }
+            p = json_skip_ws(p + 1, end);
+
+            const char* value_end = json_skip_value(p, end);
+            out.emplace_back(key.str(), json_value(p, value_end));
+
+            p = json_skip_ws(value_end, end);
+            if(*p == '}'){ return out; }
+            if(*p != ','){ throw std::runtime_error("Expected ',' or '}' in JSON object."); }
+            p = json_skip_ws(p + 1, end);
+        }
+    }
+
+    // Elements of an array, in document order.
+    std::vector<json_value> elements() const{
+        if(type != kJSONArray){ throw std::runtime_error("JSON value is not an array."); }
+
+        std::vector<json_value> out;
+        const char* p = json_skip_ws(begin + 1, end);
+        if(*p == ']'){ return out; }
+        while(true){
+            const char* value_end = json_skip_value(p, end);
+            out.emplace_back(p, value_end);
+
+            p = json_skip_ws(value_end, end);
+            if(*p == ']'){ return out; }
+            if(*p != ','){ throw std::runtime_error("Expected ',' or ']' in JSON array."); }
+            p = json_skip_ws(p + 1, end);
+        }
+    }
+
+    // Returns the member of an object with the given key, throwing if there is none.
+    json_value operator[](const std::string& key) const{
+        for(auto& member: members()){
+            if(member.first == key){ return member.second; }
+        }
+        throw std::runtime_error("Missing JSON member '" + key + "'.");
+    }
+
+    bool has(const std::string& key) const{
+        for(auto& member: members()){
+            if(member.first == key){ return true; }
+        }
+        return false;
+    }
+
+    // Contents of a string (with escapes resolved, \u escapes only for ASCII), or the text of any other scalar.
+    std::string str() const{
+        if(type != kJSONString){ return std::string(begin, end); }
+
+        std::string out;
+        for(const char* p = begin + 1; p < end - 1; p++){
+            if(*p != '\\'){ out += *p; continue; }
+            switch(*(++p)){
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': out += (char) strtol(std::string(p + 1, 4).c_str(), nullptr, 16); p += 4; break;
+                default: out += *p;
+            }
+        }
+        return out;
+    }
+
+    /* Numeric value of a number, a bool, or a string holding a number (as XGBoost stores most of its parameters). A
+     * string holding a single-element array (e.g. "[5E-1]") is accepted as well.
+     */
+    Double_t to_double() const{
+        if(type == kJSONBool){ return *begin == 't'; }
+        std::string text = str();
+        size_t first = text.find_first_not_of("[ ");
+        return strtod(text.c_str() + (first == std::string::npos ? 0 : first), nullptr);
+    }
+
+    Long64_t to_int() const{ return (Long64_t) to_double(); }
+
+    /* Converts an array of numbers (or bools, or numeric strings) into a vector, parsing each element directly with the
+     * conversion function matching T, such that e.g. floats are recovered exactly from their shortest representation.
+     */
+    template<class T> void to_vector(std::vector<T>& out) const{
+        if(type != kJSONArray){ throw std::runtime_error("JSON value is not an array."); }
+
+        out.clear();
+        const char* p = json_skip_ws(begin + 1, end);
+        while(*p != ']'){
+            T v;
+            if(*p == 't' || *p == 'f'){
+                v = (T) (*p == 't');
+                p += (*p == 't') ? 4 : 5;
+            }else{
+                bool quoted = (*p == '"');
+                char* e;
+                json_to_number(p + quoted, &e, v);
+                if(e == p + quoted){ throw std::runtime_error("Expected a number in JSON array."); }
+                p = e + quoted;
+            }
+            out.push_back(v);
+
+            p = json_skip_ws(p, end);
+            if(*p == ','){ p = json_skip_ws(p + 1, end); }
+            else if(*p != ']'){ throw std::runtime_error("Expected ',' or ']' in JSON array."); }
+        }
+    }
+} json_value;
+
+// Returns the root value of the given JSON text, checking that it holds exactly one value.
+json_value json_parse(const std::string& text){
+    const char* end = text.data() + text.size();
+    const char* begin = json_skip_ws(text.data(), end);
+    const char* value_end = json_skip_value(begin, end);
+    if(json_skip_ws(value_end, end) != end){ throw std::runtime_error("Trailing characters after JSON value."); }
+    return json_value(begin, value_end);
+}
+
+#endif //BDTBENCH_MINIJSON_H
@@ -0,0 +1,64 @@
+#ifndef BDTBENCH_PERFRECORDER_H
+#define BDTBENCH_PERFRECORDER_H
+
+#include <iostream>
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "rootbench/PerfCounters.h"
+
+/* Counts hardware events (see RB::PerfCounters) from its construction until Report, which sets them as benchmark
+ * counters per iteration together with the instructions per cycle. Meant to be constructed right before the timed loop
+ * of a benchmark and reported right after it, such that setup and teardown are left out, and to be paused along with
+ * the timing, such that the untimed work within the loop is left out as well:
+ *
+ *    perf_recorder perf;
+ *    for(auto _: state){
+ *       state.PauseTiming(); perf.Pause();
+ *       ...
+ *       perf.Resume(); state.ResumeTiming();
+ *       ...
+ *    }
+ *    perf.Report(state);
+ *
+ * Counting is opt-in, through the RB_PERF_COUNTERS env variable; if perf events are not permitted, a warning is
+ * printed once and the benchmarks run without the counters.
+ */
+typedef struct perf_recorder{
+    std::unique_ptr<RB::PerfCounters> counters;
+
+    perf_recorder(){
+        if(!RB::IsPerfCountersEnabled()){ return; }
+        counters.reset(new RB::PerfCounters());
+        if(!counters->IsValid()){
+            static bool warned = false;
+            if(!warned){
+                std::cerr << "Hardware performance counters not available: " << counters->GetError() << std::endl;
+                warned = true;
+            }
+            counters.reset();
+            return;
+        }
+        counters->Start();
+    }
+
+    void Pause(){ if(counters){ counters->Stop(); } }
+
+    void Resume(){ if(counters){ counters->Resume(); } }
+
+    void Report(benchmark::State& state){
+        if(!counters){ return; }
+        counters->Stop();
+
+        Double_t cycles = 0.0, instructions = 0.0;
+        for(const auto& value: counters->Read()){
+            state.counters[value.fName] = benchmark::Counter(value.fCount, benchmark::Counter::kAvgIterations);
+            if(value.fName == "Cycles"){ cycles = value.fCount; }
+            if(value.fName == "Instructions"){ instructions = value.fCount; }
+        }
+        if(cycles > 0.0 && instructions > 0.0){ state.counters["IPC"] = instructions / cycles; }
+        counters.reset();
+    }
+} perf_recorder;
+
+#endif //BDTBENCH_PERFRECORDER_H
@@ -0,0 +1,74 @@
+#ifndef BDTBENCH_PHASETIMER_H
+#define BDTBENCH_PHASETIMER_H
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+/* Breaks the iterations of a benchmarking loop down into named phases, accumulating the wall and CPU time spent in
+ * each of them, and reports them as benchmark counters per iteration ("<Phase> Time" and "<Phase> CPU Time", in
+ * seconds). CPU time is the one of the whole process, such that a CPU time above the wall time of a phase means it ran
+ * on several threads. Starting a phase ends the running one, and phases are reported in the order they first ran:
+ *
+ *    phase_timer phases;
+ *    for(auto _: state){
+ *       phases.Start("Setup");
+ *       ...
+ *       phases.Start("Boosting");
+ *       ...
+ *       phases.Stop();
+ *    }
+ *    phases.Report(state);
+ */
+typedef struct phase_timer{
+    typedef std::chrono::steady_clock clock;
+
+    std::vector<std::string> names;
+    std::vector<Double_t> wall_times, cpu_times; // accumulated over all iterations, in seconds
+
+    Int_t current = -1;
+    clock::time_point wall_start;
+    std::clock_t cpu_start = 0;
+
+    void Start(const std::string& name){
+        Stop();
+        current = 0;
+        while(current < (Int_t) names.size() && names[current] != name){ current++; }
+        if(current == (Int_t) names.size()){
+            names.push_back(name);
+            wall_times.push_back(0.0);
+            cpu_times.push_back(0.0);
+        }
+        cpu_start = std::clock();
+        wall_start = clock::now();
+    }
+
+    void Stop(){
+        if(current < 0){ return; }
+        std::chrono::duration<Double_t> wall_time = clock::now() - wall_start;
+        wall_times[current] += wall_time.count();
+        cpu_times[current] += (Double_t) (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        current = -1;
+    }
+
+    // Wall time accumulated by the given phase over all iterations (up to the last Stop), or 0 if it never ran.
+    Double_t Time(const std::string& name) const{
+        for(size_t i = 0; i < names.size(); i++){
+            if(names[i] == name){ return wall_times[i]; }
+        }
+        return 0.0;
+    }
+
+    void Report(benchmark::State& state){
+        Stop();
+        for(size_t i = 0; i < names.size(); i++){
+            state.counters[names[i] + " Time"] = benchmark::Counter(wall_times[i], benchmark::Counter::kAvgIterations);
+            state.counters[names[i] + " CPU Time"] = benchmark::Counter(cpu_times[i], benchmark::Counter::kAvgIterations);
+        }
+    }
+} phase_timer;
+
+#endif //BDTBENCH_PHASETIMER_H
@@ -0,0 +1,178 @@
+#ifndef BDTBENCH_QUICKSCORER_H
+#define BDTBENCH_QUICKSCORER_H
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "FlatForest.h"
+
+/* QuickScorer (Lucchese et al., SIGIR 2015) backend for the forests loaded into a flat_forest, which scores an event
+ * without traversing the trees node by node.
+ *
+ * The leaves of each tree are numbered from left to right, and each event keeps one bitvector per tree with a bit per
+ * leaf, initially all set. An inner node whose test sends the event right rules out all the leaves of its left
+ * subtree, which is a contiguous range of leaves; clearing that range from the tree's bitvector for each such node
+ * leaves the exit leaf of the event as the lowest bit still set. Since a node sends the event right iff its value is
+ * >= the threshold, the nodes of each feature are sorted by threshold across all trees, such that the nodes whose
+ * ranges have to be cleared are exactly a prefix of that list, scanned until the first threshold above the value.
+ *
+ * Trees with more than 64 leaves span several 64-bit words, the range of each node being stored as the first and last
+ * word it touches together with the masks to apply to them (the words in between being cleared entirely).
+ */
+
+typedef struct quickscorer_forest{
+    UInt_t n_trees = 0;
+    UInt_t n_features = 0;
+    UInt_t n_words = 0;
+
+    flat_forest_transform transform = kForestIdentity;
+    Double_t base_score = 0.0;
+
+    // Per tree: first bitvector word and first leaf value (global), each with n_trees + 1 entries
+    std::vector<UInt_t> tree_words;
+    std::vector<UInt_t> tree_leaves;
+    std::vector<Float_t> leaf_values;
+
+    /* Inner nodes, grouped by feature (the nodes of feature j being [feature_nodes[j], feature_nodes[j + 1])) and sorted
+     * by threshold within each feature. Masks are to be ANDed into the (global) words word_first and word_last.
+     */
+    std::vector<UInt_t> feature_nodes;
+    std::vector<Float_t> thresholds;
+    std::vector<UInt_t> word_first, word_last;
+    std::vector<ULong64_t> mask_first, mask_last;
+
+    // Inner nodes which send missing values right, grouped by feature in the same way (as indices into the above).
+    std::vector<UInt_t> missing_nodes;
+    std::vector<UInt_t> missing_right;
+
+    void ClearRange(ULong64_t* v, UInt_t node) const{
+        v[word_first[node]] &= mask_first[node];
+        for(UInt_t w = word_first[node] + 1; w < word_last[node]; w++){ v[w] = 0; }
+        v[word_last[node]] &= mask_last[node];
+    }
+
+    // Output of the model for a single event, with v being scratch space for n_words bitvector words.
+    Float_t Predict(const Float_t* x, size_t feature_stride, ULong64_t* v) const{
+        std::fill(v, v + n_words, ~0ULL);
+
+        for(UInt_t j = 0; j < n_features; j++){
+            const Float_t value = x[j * feature_stride];
+            if(std::isnan(value)){
+                for(UInt_t k = missing_nodes[j]; k < missing_nodes[j + 1]; k++){ ClearRange(v, missing_right[k]); }
+                continue;
+            }
+            for(UInt_t node = feature_nodes[j]; node < feature_nodes[j + 1] && value >= thresholds[node]; node++){
+                ClearRange(v, node);
+            }
+        }
+
+        Double_t margin = base_score;
+        for(UInt_t t = 0; t < n_trees; t++){
+            UInt_t w = tree_words[t];
+            while(!v[w]){ w++; }
+            margin += leaf_values[tree_leaves[t] + (w - tree_words[t]) * 64 + __builtin_ctzll(v[w])];
+        }
+
+        switch(transform){
+            case kForestSigmoid: return 1.0 / (1.0 + std::exp(-margin));
+            case kForestTMVAGrad: return 2.0 / (1.0 + std::exp(-2.0 * margin)) - 1.0;
+            default: return margin;
+        }
+    }
+
+    // Output of the model for all n_events events of a data set laid out as for flat_forest::Predict.
+    void Predict(const Float_t* data, size_t n_events, size_t row_stride, size_t feature_stride, Float_t* out,
+                 UInt_t n_threads = 1) const{
+        flat_forest_foreach_task(n_events, n_threads, [&](size_t begin, size_t end){
+            std::vector<ULong64_t> v(n_words);
+            for(size_t i = begin; i < end; i++){ out[i] = Predict(data + i * row_stride, feature_stride, v.data()); }
+        });
+    }
+} quickscorer_forest;
+
+/* Numbers the leaves of the subtree rooted at the given node of a flat_forest from left to right starting at
+ * first_leaf, appending their values to leaf_values and recording the leaf range [begin, end) of the left subtree of
+ * each inner node in left_ranges. Returns the end of the subtree's leaf range.
+ */
+UInt_t number_quickscorer_leaves(const flat_forest& forest, Int_t node, UInt_t first_leaf,
+                                 std::vector<Float_t>& leaf_values, std::vector<std::pair<UInt_t, UInt_t>>& left_ranges){
+    if(forest.feature[node] < 0){
+        leaf_values.push_back(forest.value[node]);
+        return first_leaf + 1;
+    }
+
+    const UInt_t left_end = number_quickscorer_leaves(forest, forest.left[node], first_leaf, leaf_values, left_ranges);
+    left_ranges[node] = std::make_pair(first_leaf, left_end);
+    return number_quickscorer_leaves(forest, forest.left[node] + 1, left_end, leaf_values, left_ranges);
+}
+
+// Builds the QuickScorer representation of a flat_forest.
+quickscorer_forest* FlatForestToQuickScorer(const flat_forest& forest){
+    auto qs = new quickscorer_forest();
+    qs->n_trees = forest.n_trees;
+    qs->n_features = forest.n_features;
+    qs->transform = forest.transform;
+    qs->base_score = forest.base_score;
+
+    // Leaf numbering and bitvector layout of each tree
+    std::vector<std::pair<UInt_t, UInt_t>> left_ranges(forest.n_nodes);
+    std::vector<UInt_t> node_tree(forest.n_nodes);
+    qs->tree_words.push_back(0);
+    qs->tree_leaves.push_back(0);
+    for(UInt_t t = 0; t < forest.n_trees; t++){
+        const UInt_t n_leaves = number_quickscorer_leaves(forest, forest.roots[t], 0, qs->leaf_values, left_ranges);
+        qs->tree_words.push_back(qs->tree_words.back() + (n_leaves + 63) / 64);
+        qs->tree_leaves.push_back(qs->tree_leaves.back() + n_leaves);
+
+        const UInt_t end = (t + 1 < forest.n_trees) ? forest.roots[t + 1] : forest.n_nodes;
+        std::fill(node_tree.begin() + forest.roots[t], node_tree.begin() + end, t);
+    }
+    qs->n_words = qs->tree_words.back();
+
+    // Inner nodes, sorted by feature and then threshold
+    std::vector<UInt_t> nodes;
+    for(UInt_t k = 0; k < forest.n_nodes; k++){
+        if(forest.feature[k] >= 0){
+            if((UInt_t) forest.feature[k] >= forest.n_features){ throw std::runtime_error("Split feature out of range."); }
+            nodes.push_back(k);
+        }
+    }
+    std::stable_sort(nodes.begin(), nodes.end(), [&](UInt_t a, UInt_t b){
+        return forest.feature[a] != forest.feature[b] ? forest.feature[a] < forest.feature[b]
+                                                      : forest.threshold[a] < forest.threshold[b];
+    });
+
+    qs->feature_nodes.assign(forest.n_features + 1, 0);
+    qs->missing_nodes.assign(forest.n_features + 1, 0);
+    for(UInt_t i = 0; i < nodes.size(); i++){
+        const UInt_t k = nodes[i];
+        const UInt_t base = qs->tree_words[node_tree[k]];
+        const UInt_t begin = left_ranges[k].first, last = left_ranges[k].second - 1;
+
+        qs->thresholds.push_back(forest.threshold[k]);
+        qs->word_first.push_back(base + begin / 64);
+        qs->word_last.push_back(base + last / 64);
+
+        // Clear the bits >= begin of the first word and the bits <= last of the last word (both, if it is the same)
+        const ULong64_t clear_first = ~0ULL << (begin % 64);
+        const ULong64_t clear_last = ~0ULL >> (63 - last % 64);
+        const bool single_word = (begin / 64 == last / 64);
+        qs->mask_first.push_back(single_word ? ~(clear_first & clear_last) : ~clear_first);
+        qs->mask_last.push_back(single_word ? ~(clear_first & clear_last) : ~clear_last);
+
+        qs->feature_nodes[forest.feature[k] + 1]++;
+        if(!forest.default_left[k]){
+            qs->missing_right.push_back(i);
+            qs->missing_nodes[forest.feature[k] + 1]++;
+        }
+    }
+    std::partial_sum(qs->feature_nodes.begin(), qs->feature_nodes.end(), qs->feature_nodes.begin());
+    std::partial_sum(qs->missing_nodes.begin(), qs->missing_nodes.end(), qs->missing_nodes.begin());
+
+    return qs;
+}
+
+#endif //BDTBENCH_QUICKSCORER_H
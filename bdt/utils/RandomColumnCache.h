@@ -0,0 +1,283 @@
+#ifndef BDTBENCH_RANDOMCOLUMNCACHE_H
+#define BDTBENCH_RANDOMCOLUMNCACHE_H
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TMVA/RTensor.hxx"
+
+#include "ContentHash.h"
+#include "MakeHEPLikeTTree.h"
+#include "MakeRandomTTree.h"
+
+/* Content-addressed, memory-mapped cache of the data sets produced by genTree, such that benchmarks regenerate their
+ * inputs (one TRandom3 draw per value) only once per machine rather than once per benchmark function.
+ *
+ * Each cache file is named after the hash of the genTree arguments and holds the generated data column-wise, in a flat
+ * layout which is mapped into memory as is:
+ *
+ *    header (64 bytes) | var0[nPoints] | var1[nPoints] | ... | EventNumber[nPoints] (only if evtCol)
+ *
+ * with no padding in between the columns. Benchmarks can hence attach to the columns directly (e.g. as a
+ * column-major RTensor), or rebuild the TTree produced by genTree from them (see genTreeCached).
+ */
+
+const char random_columns_magic[8] = {'B', 'D', 'T', 'C', 'O', 'L', 'S', '\0'};
+const UInt_t random_columns_version = 1;
+
+typedef struct random_columns_header{
+    char magic[8];
+    UInt_t version;
+    UInt_t nPoints;
+    UInt_t nVars;
+    UInt_t evtCol;
+    char padding[40]; // pads the header to 64 bytes
+} random_columns_header;
+
+/* Read-only, column-wise view of a data set held in a memory-mapped cache file. The mapping is private, so that the
+ * columns may be handed to interfaces taking non-const pointers without ever modifying the cache file.
+ */
+typedef struct random_columns{
+    UInt_t nPoints, nVars;
+    bool evtCol;
+
+    char* base;
+    size_t size;
+
+    random_columns(const std::string& path){
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0){ throw std::runtime_error("Failed to open column cache " + path); }
+
+        struct stat st;
+        fstat(fd, &st);
+        size = st.st_size;
+        base = (char*) mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(base == MAP_FAILED){ throw std::runtime_error("Failed to map column cache " + path); }
+
+        auto header = (const random_columns_header*) base;
+        if(size < sizeof(random_columns_header) || std::string(header->magic) != random_columns_magic
+           || header->version != random_columns_version){
+            munmap(base, size);
+            throw std::runtime_error("Invalid column cache " + path);
+        }
+
+        nPoints = header->nPoints;
+        nVars = header->nVars;
+        evtCol = header->evtCol;
+    }
+
+    ~random_columns(){ munmap(base, size); }
+
+    random_columns(const random_columns&) = delete;
+    random_columns& operator=(const random_columns&) = delete;
+
+    // Values of the i-th variable ("var" + i) of all the events.
+    Float_t* Column(UInt_t i) const{
+        return (Float_t*) (base + sizeof(random_columns_header)) + (size_t) i * nPoints;
+    }
+
+    // Event identifiers, only available if the data set was generated with evtCol set.
+    Int_t* EventNumbers() const{
+        return evtCol ? (Int_t*) Column(nVars) : nullptr;
+    }
+
+    // Row-major (nPoints x nVars) copy of the variables, i.e. one row of nVars values per event.
+    std::vector<Float_t> AsRows() const{
+        std::vector<Float_t> rows((size_t) nPoints * nVars);
+        for(UInt_t j = 0; j < nVars; j++){
+            const Float_t* column = Column(j);
+            for(UInt_t i = 0; i < nPoints; i++){ rows[(size_t) i * nVars + j] = column[i]; }
+        }
+        return rows;
+    }
+
+    // Column-major (nPoints x nVars) tensor over the variables, without any copy.
+    TMVA::Experimental::RTensor<Float_t> AsTensor() const{
+        return TMVA::Experimental::RTensor<Float_t>(Column(0), {nPoints, nVars},
+                                                    TMVA::Experimental::MemoryLayout::ColumnMajor);
+    }
+} random_columns;
+
+// Path of the cache file holding the data set generated by genTree (or genTreeMT if parallel) for the given arguments.
+std::string random_columns_path(const std::string& name, UInt_t nPoints, UInt_t nVars, Double_t offset, Double_t scale,
+                                UInt_t seed, bool evtCol, bool parallel = false, const std::string& cache_dir = "."){
+    ULong64_t hash = content_hash(name.data(), name.size());
+    hash = content_hash(&nPoints, sizeof(nPoints), hash);
+    hash = content_hash(&nVars, sizeof(nVars), hash);
+    hash = content_hash(&offset, sizeof(offset), hash);
+    hash = content_hash(&scale, sizeof(scale), hash);
+    hash = content_hash(&seed, sizeof(seed), hash);
+    hash = content_hash(&evtCol, sizeof(evtCol), hash);
+    hash = content_hash(&parallel, sizeof(parallel), hash);
+
+    return cache_dir + "/bdt_bench_columns_" + content_hash_str(hash) + ".cols";
+}
+
+/* Writes the given column-major data set (nVars columns of nPoints values, with room for the event identifier column if
+ * evtCol) to a cache file at path, filling in the event identifiers.
+ */
+void writeColumns(const std::string& path, UInt_t nPoints, UInt_t nVars, bool evtCol, std::vector<Float_t>& data){
+    if(evtCol){ // the event identifiers are stored bitwise in the last column
+        for(UInt_t j = 0; j < nPoints; j++){
+            Int_t id = j;
+            memcpy(&data[(size_t) nVars * nPoints + j], &id, sizeof(id));
+        }
+    }
+
+    random_columns_header header = {};
+    std::copy(random_columns_magic, random_columns_magic + 8, header.magic);
+    header.version = random_columns_version;
+    header.nPoints = nPoints;
+    header.nVars = nVars;
+    header.evtCol = evtCol;
+
+    // Write to a temporary file first, such that concurrent benchmark runs never map a partially written file
+    const std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if(file == nullptr){ throw std::runtime_error("Failed to create column cache " + tmp_path); }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && (data.empty() || fwrite(data.data(), data.size() * sizeof(Float_t), 1, file) == 1);
+    ok = (fclose(file) == 0) && ok;
+    if(!ok || rename(tmp_path.c_str(), path.c_str()) != 0){
+        throw std::runtime_error("Failed to write column cache " + path);
+    }
+}
+
+/* Writes the data set which genTree (or genTreeMT if parallel) generates for the given arguments to a cache file at
+ * path; the values are drawn in the very same order as by these functions, hence are identical to the ones of the
+ * generated TTree.
+ */
+void writeRandomColumns(const std::string& path, UInt_t nPoints, UInt_t nVars, Double_t offset, Double_t scale,
+                        UInt_t seed, bool evtCol, bool parallel = false){
+    std::vector<Float_t> data((size_t) nPoints * (nVars + (evtCol ? 1 : 0)), 0.0);
+
+    if(parallel){
+        genColumnsMT(data.data(), nPoints, 0, nPoints, nVars, offset, scale, seed);
+    }else{
+        TRandom3 rng(seed);
+        for(UInt_t j = 0; j < nPoints; j++){
+            for(UInt_t i = 0; i < nVars; i++){
+                data[(size_t) i * nPoints + j] = rng.Gaus(offset, scale);
+            }
+        }
+    }
+
+    writeColumns(path, nPoints, nVars, evtCol, data);
+}
+
+/* Returns a memory-mapped view of the data set which genTree (or genTreeMT if parallel) generates for the given
+ * arguments, generating and caching it first if no cache file exists yet. The returned instance is owned by the caller.
+ */
+random_columns* genColumnsCached(const std::string& name, UInt_t nPoints, const UInt_t nVars, Double_t offset,
+                                 Double_t scale = 0.3, UInt_t seed = 100, bool evtCol = true, bool parallel = false,
+                                 const std::string& cache_dir = "."){
+    const std::string path = random_columns_path(name, nPoints, nVars, offset, scale, seed, evtCol, parallel, cache_dir);
+    if(access(path.c_str(), R_OK) != 0){
+        writeRandomColumns(path, nPoints, nVars, offset, scale, seed, evtCol, parallel);
+    }
+
+    return new random_columns(path);
+}
+
+// Builds a TTree with the same branches as genTree (and the same entries as the generator of the columns).
+TTree* columnsToTree(std::string name, const random_columns& columns){
+    // Initialisation
+    std::vector<Float_t> vars(columns.nVars, 0.0);
+    Int_t id = 0;
+
+    // Create new TTree instance, with a branch corresponding to each variable and to the (unique) Event identifier
+    auto data = new TTree(name.c_str(),name.c_str());
+    for(UInt_t i = 0; i < columns.nVars; i++){
+        std::string var_name = "var" + std::to_string(i);
+        std::string var_leaflist = var_name + "/F";
+
+        data->Branch(var_name.c_str(), vars.data() + i, var_leaflist.c_str());
+    }
+    if(columns.evtCol){
+        data->Branch("EventNumber", &id, "EventNumber/I");
+    }
+
+    // Populate TTree instance with the cached data
+    for(UInt_t j = 0; j < columns.nPoints; j++){
+        for(UInt_t i = 0; i < columns.nVars; i++){
+            vars[i] = columns.Column(i)[j];
+        }
+        if(columns.evtCol){
+            id = columns.EventNumbers()[j];
+        }
+
+        data->Fill();
+    }
+
+    // Important: Disconnects the tree from the memory locations of vars[i]
+    data->ResetBranchAddresses();
+    return data;
+}
+
+/* Drop-in replacement for genTree (or genTreeMT if parallel), which fills the TTree from the cached columns rather than
+ * drawing the values. The resulting TTree is identical to the one produced by genTree (genTreeMT) for the same arguments.
+ */
+TTree* genTreeCached(std::string name, UInt_t nPoints, const UInt_t nVars, Double_t offset, Double_t scale = 0.3,
+                     UInt_t seed = 100, bool evtCol = true, bool parallel = false, const std::string& cache_dir = "."){
+    random_columns* columns = genColumnsCached(name, nPoints, nVars, offset, scale, seed, evtCol, parallel, cache_dir);
+    TTree* data = columnsToTree(name, *columns);
+    delete columns;
+
+    return data;
+}
+
+// Path of the cache file holding the data set generated by genHEPTree for the given arguments.
+std::string random_hep_columns_path(const std::string& name, UInt_t nPoints, UInt_t nVars, bool signal,
+                                    const hep_gen_opts& opts, UInt_t seed, bool evtCol, const std::string& cache_dir = "."){
+    ULong64_t hash = content_hash(name.data(), name.size());
+    hash = content_hash(&nPoints, sizeof(nPoints), hash);
+    hash = content_hash(&nVars, sizeof(nVars), hash);
+    hash = content_hash(&signal, sizeof(signal), hash);
+    hash = content_hash(&opts.separation, sizeof(opts.separation), hash);
+    hash = content_hash(&opts.correlation, sizeof(opts.correlation), hash);
+    hash = content_hash(opts.covariance.data(), opts.covariance.size() * sizeof(Double_t), hash);
+    hash = content_hash(&opts.nonlinearity, sizeof(opts.nonlinearity), hash);
+    hash = content_hash(&opts.tail_fraction, sizeof(opts.tail_fraction), hash);
+    hash = content_hash(&opts.tail_dof, sizeof(opts.tail_dof), hash);
+    hash = content_hash(&opts.positive_fraction, sizeof(opts.positive_fraction), hash);
+    hash = content_hash(&seed, sizeof(seed), hash);
+    hash = content_hash(&evtCol, sizeof(evtCol), hash);
+
+    return cache_dir + "/bdt_bench_hep_columns_" + content_hash_str(hash) + ".cols";
+}
+
+/* Returns a memory-mapped view of the data set which genHEPTree generates for the given arguments, generating and
+ * caching it first if no cache file exists yet. The returned instance is owned by the caller.
+ */
+random_columns* genHEPColumnsCached(const std::string& name, UInt_t nPoints, const UInt_t nVars, bool signal,
+                                    const hep_gen_opts& opts, UInt_t seed = 100, bool evtCol = true,
+                                    const std::string& cache_dir = "."){
+    const std::string path = random_hep_columns_path(name, nPoints, nVars, signal, opts, seed, evtCol, cache_dir);
+    if(access(path.c_str(), R_OK) != 0){
+        std::vector<Float_t> data((size_t) nPoints * (nVars + (evtCol ? 1 : 0)), 0.0);
+        genHEPColumns(data.data(), nPoints, nPoints, nVars, signal, opts, seed);
+        writeColumns(path, nPoints, nVars, evtCol, data);
+    }
+
+    return new random_columns(path);
+}
+
+// Drop-in replacement for genHEPTree, which fills the TTree from the cached columns rather than generating the values.
+TTree* genHEPTreeCached(std::string name, UInt_t nPoints, const UInt_t nVars, bool signal, const hep_gen_opts& opts,
+                        UInt_t seed = 100, bool evtCol = true, const std::string& cache_dir = "."){
+    random_columns* columns = genHEPColumnsCached(name, nPoints, nVars, signal, opts, seed, evtCol, cache_dir);
+    TTree* data = columnsToTree(name, *columns);
+    delete columns;
+
+    return data;
+}
+
+#endif //BDTBENCH_RANDOMCOLUMNCACHE_H
@@ -0,0 +1,37 @@
+#ifndef BDTBENCH_THREADBUDGET_H
+#define BDTBENCH_THREADBUDGET_H
+
+#include <algorithm>
+#include <cmath>
+
+/* Thread budget of a pipeline in which ROOT (implicit multi-threading, i.e. the TBB pool behind RDataFrame) and
+ * XGBoost (its OpenMP pool, sized by the nthread parameter) run concurrently. The two pools know nothing of each
+ * other, such that configuring each of them with all the threads of the job, as is done when they run one after the
+ * other, puts twice as many threads as cores to work once they overlap.
+ */
+enum thread_budget_mode{
+    kBudgetIndependent, // each pool is given the whole budget (oversubscribing the cores when both are busy)
+    kBudgetShared       // the budget is split between the pools, such that together they use as many threads as cores
+};
+
+typedef struct thread_budget{
+    UInt_t imt_threads = 1;     // threads of ROOT's implicit multi-threading pool
+    UInt_t xgboost_threads = 1; // nthread of XGBoost
+} thread_budget;
+
+/* Splits n_threads between the ROOT and XGBoost pools, the ROOT pool getting imt_share of them in shared mode (and
+ * each pool at least one thread).
+ */
+thread_budget split_thread_budget(UInt_t n_threads, thread_budget_mode mode, Double_t imt_share = 0.5){
+    thread_budget budget;
+    if(mode == kBudgetIndependent){
+        budget.imt_threads = budget.xgboost_threads = std::max(n_threads, 1u);
+        return budget;
+    }
+
+    budget.imt_threads = std::max<Int_t>(std::lround(n_threads * imt_share), 1);
+    budget.xgboost_threads = std::max<Int_t>((Int_t) n_threads - (Int_t) budget.imt_threads, 1);
+    return budget;
+}
+
+#endif //BDTBENCH_THREADBUDGET_H
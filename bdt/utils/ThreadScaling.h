@@ -0,0 +1,175 @@
+#ifndef BDTBENCH_THREADSCALING_H
+#define BDTBENCH_THREADSCALING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <dirent.h>
+#include <sched.h>
+
+#include "benchmark/benchmark.h"
+
+/* Thread-scaling support: the core topology of the machine, the thread counts to sweep over, and the confinement of
+ * the benchmarks to explicit core sets, such that a run with n threads gets n hardware threads of its own.
+ *
+ * Hardware threads are ordered such that the first n of them make the most of n threads: one hardware thread per
+ * physical core first (filling up one package after the other), and the SMT siblings after all physical cores are
+ * taken. Only the CPUs the process is allowed to run on are considered.
+ */
+
+typedef struct cpu_topology{
+    std::vector<Int_t> cpus; // allowed logical CPUs, in the order they are handed out
+    UInt_t n_physical = 0;   // number of physical cores with at least one allowed CPU
+
+    UInt_t NLogical() const{ return cpus.size(); }
+
+    // The first n CPUs of the ordering (all of them if n exceeds the number of logical CPUs).
+    std::vector<Int_t> CPUSet(UInt_t n) const{
+        return std::vector<Int_t>(cpus.begin(), cpus.begin() + std::min<size_t>(n, cpus.size()));
+    }
+} cpu_topology;
+
+Int_t read_sys_cpu_value(Int_t cpu, const std::string& name){
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    Int_t value = -1;
+    in >> value;
+    return in ? value : -1;
+}
+
+// Core topology of the machine, read from /sys once (each CPU being its own core if the topology is not exposed).
+const cpu_topology& get_cpu_topology(){
+    static const cpu_topology topology = []{
+        std::vector<Int_t> allowed;
+        cpu_set_t mask;
+        if(sched_getaffinity(0, sizeof(mask), &mask) == 0){
+            for(Int_t cpu = 0; cpu < CPU_SETSIZE; cpu++){ if(CPU_ISSET(cpu, &mask)){ allowed.push_back(cpu); } }
+        }else{
+            const UInt_t n_cpus = std::max(1u, std::thread::hardware_concurrency());
+            for(UInt_t cpu = 0; cpu < n_cpus; cpu++){ allowed.push_back(cpu); }
+        }
+
+        // (SMT rank within the core, package, core, cpu) of each CPU, the rank being 0 for the first CPU of each core
+        std::map<std::pair<Int_t, Int_t>, Int_t> core_cpus;
+        std::vector<std::tuple<Int_t, Int_t, Int_t, Int_t>> order;
+        for(Int_t cpu: allowed){
+            Int_t package = read_sys_cpu_value(cpu, "physical_package_id");
+            Int_t core = read_sys_cpu_value(cpu, "core_id");
+            if(core < 0){ package = 0; core = cpu; }
+            Int_t rank = core_cpus[std::make_pair(package, core)]++;
+            order.emplace_back(rank, package, core, cpu);
+        }
+        std::sort(order.begin(), order.end());
+
+        cpu_topology t;
+        for(const auto& entry: order){ t.cpus.push_back(std::get<3>(entry)); }
+        t.n_physical = core_cpus.size();
+        return t;
+    }();
+    return topology;
+}
+
+/* Thread counts for a scaling sweep up to all hardware threads: the powers of two below the number of logical CPUs,
+ * the number of physical cores and the number of logical CPUs.
+ */
+std::vector<int64_t> thread_sweep(){
+    const cpu_topology& topology = get_cpu_topology();
+    std::vector<int64_t> threads = {(int64_t) topology.n_physical, (int64_t) topology.NLogical()};
+    for(int64_t n = 1; n < topology.NLogical(); n *= 2){ threads.push_back(n); }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+    return threads;
+}
+
+/* Confines all the threads of the process (and hence the ones they create later) to the given CPUs, returning false if
+ * the affinity could not be set. Thread pools which already exist are confined as well, since their threads are not
+ * known individually to the benchmarks.
+ */
+bool set_process_affinity(const std::vector<Int_t>& cpus){
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for(Int_t cpu: cpus){ CPU_SET(cpu, &mask); }
+
+    bool ok = (sched_setaffinity(0, sizeof(mask), &mask) == 0);
+    if(DIR* dir = opendir("/proc/self/task")){
+        while(dirent* entry = readdir(dir)){
+            if(entry->d_name[0] != '.'){ sched_setaffinity(std::atoi(entry->d_name), sizeof(mask), &mask); }
+        }
+        closedir(dir);
+    }
+    return ok;
+}
+
+/* Runs a benchmark on n_threads hardware threads of its own, from its construction to Report, and measures the time of
+ * its timed iterations (leaving out the regions paused along with the timing of the benchmark). Report sets the speedup
+ * over a single thread and the parallel efficiency (speedup / threads) as counters, the single-thread reference being
+ * measured by Report itself, within the same run: the given reference carries out one iteration of the benchmark on a
+ * single thread and returns its timed duration (in seconds), and is run on one hardware thread for as many iterations
+ * as the benchmark ran, or until it took as long as the benchmark (at least once). The affinity of the process is
+ * restored by Report. Runs with more threads than logical CPUs are not confined, hence get no speedup either.
+ *
+ *    thread_scaling scaling(state.range(2));
+ *    for(auto _: state){
+ *       state.PauseTiming(); scaling.Pause();
+ *       ...
+ *       scaling.Resume(); state.ResumeTiming();
+ *       ...
+ *    }
+ *    scaling.Report(state, [&](){ ...; return seconds; });
+ */
+typedef struct thread_scaling{
+    typedef std::chrono::steady_clock clock;
+
+    UInt_t n_threads;
+    bool pinned = false;
+    Double_t time = 0.0; // timed time, accumulated over all iterations, in seconds
+    clock::time_point start;
+
+    thread_scaling(UInt_t threads): n_threads(threads){
+        if(n_threads <= get_cpu_topology().NLogical()){
+            pinned = set_process_affinity(get_cpu_topology().CPUSet(n_threads));
+        }
+        start = clock::now();
+    }
+
+    void Pause(){ time += std::chrono::duration<Double_t>(clock::now() - start).count(); }
+
+    void Resume(){ start = clock::now(); }
+
+    void Report(benchmark::State& state, const std::function<Double_t()>& reference){
+        Pause();
+        const int64_t iterations = std::max<int64_t>(state.iterations(), 1);
+        const Double_t iteration_time = time / iterations;
+
+        state.counters["Pinned CPUs"] = pinned ? get_cpu_topology().CPUSet(n_threads).size() : 0;
+        if(n_threads <= get_cpu_topology().NLogical()){
+            Double_t reference_time = 0.0;
+            int64_t reference_iterations = 0;
+            if(n_threads == 1){
+                reference_time = time;
+                reference_iterations = iterations;
+            }else{
+                set_process_affinity(get_cpu_topology().CPUSet(1));
+                do{
+                    reference_time += reference();
+                    reference_iterations++;
+                }while(reference_iterations < iterations && reference_time < time);
+            }
+
+            set_process_affinity(get_cpu_topology().cpus);
+
+            const Double_t speedup = reference_time / reference_iterations / iteration_time;
+            state.counters["Speedup"] = speedup;
+            state.counters["Parallel Efficiency"] = speedup / n_threads;
+        }
+    }
+} thread_scaling;
+
+#endif //BDTBENCH_THREADSCALING_H
@@ -5,8 +5,23 @@
 #ifndef ROOT2XGBOOST_ROOT2XGBOOST_H
 #define ROOT2XGBOOST_ROOT2XGBOOST_H
 
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
 #include <xgboost/c_api.h>
 #include <ROOT/RDataFrame.hxx>
+#include <ROOT/RDFHelpers.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+#include <TTreeReader.h>
+#include <TTreeReaderValue.h>
+#include <TMVA/Event.h>
 #include <TMVA/DataLoader.h>
 #include <TMVA/DataSetInfo.h>
 #include <TMVA/DataSet.h>
@@ -32,30 +47,161 @@ using namespace std;
  * free() should be called to 'destruct' an xgboost_data instance; especially important since it
  * frees memory associated with DMatrix instances, which otherwise could lead to memory leaks.
  */
+struct xgboost_chunk_iter;
+void xgboost_chunk_iter_free(xgboost_chunk_iter* iter);
+
 typedef struct xgboost_data{
     // meta-data
     DMatrixHandle sb_dmats[1];
     Float_t* weights;
     Float_t* labels;
     Long64_t n_sig, n_bgd;
+    xgboost_chunk_iter* chunk_iter = nullptr; // only set when the DMatrix was built in streaming mode
 
-    xgboost_data(Long64_t n_sig, Long64_t n_bgd){
+    // The labels and weights arrays are only allocated if alloc_info is set (the streaming conversions leave them unset)
+    xgboost_data(Long64_t n_sig, Long64_t n_bgd, bool alloc_info = true){
         this->n_sig = n_sig;
         this->n_bgd = n_bgd;
 
-        this->weights = new Float_t[n_sig + n_bgd];
-        this->labels = new Float_t[n_sig + n_bgd];
+        this->weights = alloc_info ? new Float_t[n_sig + n_bgd] : nullptr;
+        this->labels = alloc_info ? new Float_t[n_sig + n_bgd] : nullptr;
     }
 
     // call for memory management
     void free() const{
+        delete[] weights;
+        delete[] labels;
         safe_xgboost(XGDMatrixFree(sb_dmats[0]))
+        if(chunk_iter != nullptr){ xgboost_chunk_iter_free(chunk_iter); }
     }
 } xgboost_data;
 
 typedef pair<char const*, char const*> kv_pair;
 typedef vector<kv_pair> xgbooster_opts;
 
+/* RDataFrame action which copies, within a single event loop, the variables of every event into the event's row of a
+ * preallocated row-major buffer. The variables are read by the action itself, through one TTreeReaderValue per variable
+ * on the TTreeReader of each task, such that no per-event container is built for the row.
+ *
+ * The row of an event is given by its entry number in the tree, as reported by the TTreeReader of the task: unlike
+ * rdfentry_, this is the position of the event in the tree also when running multi-threaded, so that each processing
+ * slot writes a disjoint set of rows, in the same order as a serial read of the tree, and no synchronisation is
+ * required. Entries outside of the buffer are rejected.
+ */
+class xgboost_row_filler : public ROOT::Detail::RDF::RActionImpl<xgboost_row_filler>{
+public:
+    using Result_t = ULong64_t; // number of rows filled
+
+private:
+    shared_ptr<ULong64_t> n_filled;
+    vector<ULong64_t> slot_n_filled;
+    Float_t* rows;
+    vector<string> variables;
+    Long64_t n_rows;
+
+    // TTreeReader of the task being processed by each slot, and the readers of the variables on it
+    vector<TTreeReader*> slot_readers;
+    vector<vector<unique_ptr<TTreeReaderValue<Float_t>>>> slot_values;
+
+public:
+    xgboost_row_filler(Float_t* rows, Long64_t n_rows, const vector<string>& variables, unsigned int n_slots)
+        : n_filled(make_shared<ULong64_t>(0)), slot_n_filled(n_slots, 0), rows(rows), variables(variables),
+          n_rows(n_rows), slot_readers(n_slots, nullptr), slot_values(n_slots){}
+    xgboost_row_filler(xgboost_row_filler&&) = default;
+    xgboost_row_filler(const xgboost_row_filler&) = delete;
+
+    shared_ptr<ULong64_t> GetResultPtr() const{ return n_filled; }
+
+    void Initialize(){}
+
+    void InitTask(TTreeReader* reader, unsigned int slot){
+        if(reader == nullptr){
+            throw runtime_error("xgboost_row_filler requires a data frame reading from a TTree.");
+        }
+
+        // Readers of the previous task of the slot are released first (their TTreeReader may no longer exist, which
+        // TTreeReaderValue supports)
+        slot_readers[slot] = reader;
+        slot_values[slot].clear();
+        for(auto& var: variables){
+            slot_values[slot].emplace_back(new TTreeReaderValue<Float_t>(*reader, var.c_str()));
+        }
+    }
+
+    void Exec(unsigned int slot){
+        const Long64_t entry = slot_readers[slot]->GetCurrentEntry();
+        if(entry < 0 || entry >= n_rows){
+            throw runtime_error("Entry " + to_string(entry) + " lies outside of the row buffer.");
+        }
+
+        Float_t* row = rows + entry * variables.size();
+        auto& values = slot_values[slot];
+        for(size_t j = 0; j < values.size(); j++){
+            row[j] = *(values[j]->Get());
+        }
+        slot_n_filled[slot]++;
+    }
+
+    void Finalize(){
+        for(auto n: slot_n_filled){ *n_filled += n; }
+        slot_values.clear();
+    }
+
+    string GetActionName(){ return "xgboost_row_filler"; }
+};
+
+/* Books an xgboost_row_filler action on the data frame of the given tree, filling the given variables of its entries
+ * into the (tree.GetEntries() x variables.size()) row-major buffer rows once the event loop is run.
+ */
+ROOT::RDF::RResultPtr<ULong64_t> book_xgboost_row_filler(ROOT::RDataFrame& dframe, TTree& tree,
+                                                         const vector<string>& variables, Float_t* rows){
+    return dframe.Book<>(xgboost_row_filler(rows, tree.GetEntries(), variables, dframe.GetNSlots()), {});
+}
+
+/* Copies the given variables of the entries [begin, end) of a tree into the row-major buffer rows, setting the labels
+ * of these events to label. The variables are read through branch addresses, which are reset before returning.
+ */
+void fill_xgboost_rows_from_tree(TTree& tree, const vector<string>& variables, Long64_t begin, Long64_t end,
+                                 Float_t label, Float_t* rows, Float_t* labels){
+    const auto n_vars = variables.size();
+    vector<Float_t> values(n_vars);
+    for(size_t j = 0; j < n_vars; j++){
+        tree.SetBranchAddress(variables[j].c_str(), &values[j]);
+    }
+
+    for(Long64_t i = begin; i < end; i++){
+        if(tree.GetEntry(i) <= 0){
+            tree.ResetBranchAddresses();
+            throw runtime_error("Failed to read entry " + to_string(i) + " of tree " + tree.GetName());
+        }
+        copy(values.begin(), values.end(), rows + (i - begin) * n_vars);
+        labels[i - begin] = label;
+    }
+
+    tree.ResetBranchAddresses();
+}
+
+/* Checks that the rows filled by the single event loop of xgboost_row_filler (multi-threaded if implicit
+ * multi-threading is enabled) are the ones of a serial, entry by entry, read of the tree, returning the number of
+ * mismatching values (0 if the rows are filled in order).
+ */
+ULong64_t xgboost_row_order_mismatches(TTree& tree, const vector<string>& variables){
+    const Long64_t n_entries = tree.GetEntries();
+    vector<Float_t> rows(n_entries * variables.size()), serial_rows(rows.size()), labels(n_entries);
+
+    ROOT::RDataFrame dframe(tree);
+    if((Long64_t) *book_xgboost_row_filler(dframe, tree, variables, rows.data()) != n_entries){
+        return rows.size();
+    }
+    fill_xgboost_rows_from_tree(tree, variables, 0, n_entries, 0.0, serial_rows.data(), labels.data());
+
+    ULong64_t mismatches = 0;
+    for(size_t k = 0; k < rows.size(); k++){
+        if(rows[k] != serial_rows[k]){ mismatches++; }
+    }
+    return mismatches;
+}
+
 /* Utility function for converting from ROOT's TTree data representation, to xgboost's DMatrix representation.
  * Furthermore,
  * (i)  We also extract the number of signal and background events.
@@ -64,68 +210,176 @@ typedef vector<kv_pair> xgbooster_opts;
  * All this data is wrapped in an xgboost_data instance, the internals of which can be used with xgboost's C-api.
  *
  * The passed vector<string> of variable names specifies which branches to extract from the respective TTree instances.
+ *
+ * By default, all the variables of a tree are extracted in a single event loop, booking one xgboost_row_filler action
+ * per tree; the event loops over the signal and background trees are run concurrently and, with implicit
+ * multi-threading enabled, are themselves parallelised. Setting single_pass to false selects the previous behaviour,
+ * which runs one Take action (i.e. one event loop) per variable and per tree; as Take collects the values of the
+ * processing slots one after the other, this only preserves the order of the events when running single-threaded.
  */
-xgboost_data* ROOTToXGBoost(TTree& signal_tree, TTree& background_tree, vector<string>& variables, const Float_t* sig_weight, const Float_t* bgd_weight){
+xgboost_data* ROOTToXGBoost(TTree& signal_tree, TTree& background_tree, vector<string>& variables, const Float_t* sig_weight,
+                            const Float_t* bgd_weight, bool single_pass = true){
 
-    // Represent signal TTree as a data frame
+    // Represent signal and background TTrees as data frames
     ROOT::RDataFrame sig_dframe(signal_tree);
-    auto n_sig = sig_dframe.Count(); // and extract the number of signal events
-
-    // Represent background TTree as a data frame
     ROOT::RDataFrame bgd_dframe(background_tree);
-    auto n_bgd = bgd_dframe.Count(); // and extract the number of background events
+
+    // Extract the number of signal and background events, without running an event loop
+    Long64_t n_sig = signal_tree.GetEntries();
+    Long64_t n_bgd = background_tree.GetEntries();
 
     const auto n_vars = variables.size(); // count the number of vars
 
-    // Initialise Float_t array to hold a 2-dim representation of the signal and background trees
-    Float_t sb_mat[*n_sig + *n_bgd][n_vars];
+    // Initialise a (heap allocated) row-major Float_t buffer to hold a 2-dim representation of the signal and
+    // background trees; a stack array would overflow long before realistic sample sizes are reached
+    vector<Float_t> sb_mat((n_sig + n_bgd) * n_vars);
 
-    // Loop across the variables and events, populating sb_mat resulting in a 2-dim representation of the signal and
-    // background trees
-    Long64_t i; Long64_t j = 0;
-    for(auto& var: variables){
-        i = 0;
-        for(auto& sig_mat_ij: sig_dframe.Take<Float_t>(var)){ // first n_sig rows will be signal data
-            sb_mat[i][j] = sig_mat_ij;
-            i++;
+    if(single_pass){
+        // The first n_sig rows will be signal data, and the following n_bgd rows will be background data
+        auto sig_filled = book_xgboost_row_filler(sig_dframe, signal_tree, variables, sb_mat.data());
+        auto bgd_filled = book_xgboost_row_filler(bgd_dframe, background_tree, variables, sb_mat.data() + n_sig * n_vars);
+
+        ROOT::RDF::RunGraphs({sig_filled, bgd_filled});
+
+        if((Long64_t) *sig_filled != n_sig || (Long64_t) *bgd_filled != n_bgd){
+            throw runtime_error("Number of converted events does not match the number of entries of the input trees.");
         }
-        for(auto& bgd_mat_ij: bgd_dframe.Take<Float_t>(var)){ // and the following n_bgd rows will be background data
-            sb_mat[i][j] = bgd_mat_ij;
-            i++;
+    }else{
+        // Loop across the variables and events, populating sb_mat resulting in a 2-dim representation of the signal and
+        // background trees
+        Long64_t i; Long64_t j = 0;
+        for(auto& var: variables){
+            i = 0;
+            for(auto& sig_mat_ij: sig_dframe.Take<Float_t>(var)){ // first n_sig rows will be signal data
+                sb_mat[i * n_vars + j] = sig_mat_ij;
+                i++;
+            }
+            for(auto& bgd_mat_ij: bgd_dframe.Take<Float_t>(var)){ // and the following n_bgd rows will be background data
+                sb_mat[i * n_vars + j] = bgd_mat_ij;
+                i++;
+            }
+
+            j++;
         }
-
-        j++;
     }
 
-    auto data = new xgboost_data(*n_sig, *n_bgd); // maintains xgboost readable data
+    auto data = new xgboost_data(n_sig, n_bgd); // maintains xgboost readable data
 
     Float_t sw; // unless given a weight for signal data, we calculate a balanced weight
     if(sig_weight == nullptr){
-        sw = 1.0 + (*n_bgd/(*n_sig));
+        sw = 1.0 + (n_bgd/n_sig);
     }else{
         sw = *sig_weight;
     }
 
     // Set the weight for the signal data, and the labels to 0.0
-    for(Long64_t k = 0; k < *n_sig; k++){ (data->labels)[k] = 0.0; (data->weights)[k] = sw; }
+    for(Long64_t k = 0; k < n_sig; k++){ (data->labels)[k] = 0.0; (data->weights)[k] = sw; }
 
     Float_t bw; // unless given a weight for background data, we calculate a balanced weight
     if(bgd_weight == nullptr){
-        bw = 1.0 + (*n_sig/(*n_bgd));
+        bw = 1.0 + (n_sig/n_bgd);
     }else{
         bw = *bgd_weight;
     }
 
     // Set the weight for the background data, and the labels to 1.0
-    for(Long64_t k = *n_sig; k < (*n_sig + *n_bgd); k++){ (data->labels)[k] = 1.0; (data->weights)[k] = bw; }
+    for(Long64_t k = n_sig; k < (n_sig + n_bgd); k++){ (data->labels)[k] = 1.0; (data->weights)[k] = bw; }
 
     // Populate the DMatrix datastructure held in the xgboost_data instance...
-    safe_xgboost(XGDMatrixCreateFromMat((Float_t*) sb_mat, *n_sig + *n_bgd, n_vars, 0, &((data->sb_dmats)[0])))
-    safe_xgboost(XGDMatrixSetFloatInfo((data->sb_dmats)[0], "label", data->labels, *n_sig + *n_bgd))
+    safe_xgboost(XGDMatrixCreateFromMat(sb_mat.data(), n_sig + n_bgd, n_vars, 0, &((data->sb_dmats)[0])))
+    safe_xgboost(XGDMatrixSetFloatInfo((data->sb_dmats)[0], "label", data->labels, n_sig + n_bgd))
 
     return data;
 }
 
+/* Strategies for copying the event values of a TMVA::DataSet into the row-major buffer backing a DMatrix:
+ * (i)  kFillPerCell copies value by value, through one Event::GetValue call per cell.
+ * (ii) kFillBlocked copies event by event, from the contiguous values of the event, with blocks of events being
+ *      distributed across the threads of a ROOT::TThreadExecutor.
+ */
+enum xgboost_fill_mode{ kFillPerCell, kFillBlocked };
+
+// Number of events copied by each task of the blocked fill; the rows of a block remain cache resident while being written
+const Long64_t xgboost_fill_block_size = 4096;
+
+/* Copies the events in the range [begin, end) of the given event collection into the row-major buffer rows (n_vars
+ * values per event), together with their labels (0.0 for signal, 1.0 for background) and original weights.
+ */
+void fill_xgboost_rows(const TMVA::DataSetInfo& dataset_info, const vector<TMVA::Event*>& events, Long64_t begin,
+                       Long64_t end, UInt_t n_vars, Float_t* rows, Float_t* labels, Float_t* weights){
+    for(Long64_t i = begin; i < end; i++){
+        const TMVA::Event* event = events[i];
+
+        // Populate the row of the 2d matrix, from the values of the event which are held contiguously...
+        const vector<Float_t>& values = event->GetValues();
+        copy(values.begin(), values.begin() + n_vars, rows + (i - begin) * n_vars);
+
+        // Labels are 0.0 for signal and 1.0 for background data, whereas the original weights are kept as they are
+        labels[i - begin] = dataset_info.IsSignal(event) ? 0.0 : 1.0;
+        weights[i - begin] = event->GetOriginalWeight();
+    }
+}
+
+// As fill_xgboost_rows, but copying the values of each event one at a time.
+void fill_xgboost_rows_per_cell(const TMVA::DataSetInfo& dataset_info, const vector<TMVA::Event*>& events, Long64_t begin,
+                                Long64_t end, UInt_t n_vars, Float_t* rows, Float_t* labels, Float_t* weights){
+    for(Long64_t i = begin; i < end; i++){
+        const TMVA::Event* event = events[i];
+
+        // Populate the row of the 2d matrix...
+        Float_t* row = rows + (i - begin) * n_vars;
+        for(UInt_t j = 0; j < n_vars; j++){
+            row[j] = event->GetValue(j);
+        }
+
+        if(dataset_info.IsSignal(event)){ // Set the weight for the signal data, and the labels to 0.0
+            labels[i - begin] = 0.0;
+            weights[i - begin] = event->GetOriginalWeight();
+        }else{
+            labels[i - begin] = 1.0; // Set the weight for the background data, and the labels to 1.0
+            weights[i - begin] = event->GetOriginalWeight();
+        }
+    }
+}
+
+/* As fill_xgboost_rows over the first n_events events of the collection, but with blocks of xgboost_fill_block_size
+ * events being filled in parallel by the threads of the given executor, which callers converting repeatedly keep
+ * across conversions rather than starting the threads of a new executor each time. Blocks cover disjoint rows of the
+ * output buffers, so no synchronisation is required.
+ */
+void fill_xgboost_rows_parallel(const TMVA::DataSetInfo& dataset_info, const vector<TMVA::Event*>& events,
+                                Long64_t n_events, UInt_t n_vars, Float_t* rows, Float_t* labels, Float_t* weights,
+                                ROOT::TThreadExecutor& pool){
+    if(pool.GetPoolSize() == 1 || n_events <= xgboost_fill_block_size){
+        fill_xgboost_rows(dataset_info, events, 0, n_events, n_vars, rows, labels, weights);
+        return;
+    }
+
+    const ULong_t n_blocks = (n_events + xgboost_fill_block_size - 1) / xgboost_fill_block_size;
+    auto fill_block = [&](ULong_t block){
+        const Long64_t begin = block * xgboost_fill_block_size;
+        const Long64_t end = min(begin + xgboost_fill_block_size, n_events);
+        fill_xgboost_rows(dataset_info, events, begin, end, n_vars, rows + begin * n_vars, labels + begin, weights + begin);
+    };
+
+    pool.Foreach(fill_block, ROOT::TSeqUL(n_blocks));
+}
+
+/* Extracts the number of signal and background events of the given tree type from a DataSet, throwing if the tree
+ * type is neither kTesting nor kTraining.
+ */
+void count_xgboost_events(TMVA::DataSet* dataset, TMVA::Types::ETreeType type, Long64_t& n_sig, Long64_t& n_bgd){
+    if(type == TMVA::Types::kTesting){
+        n_sig = dataset->GetNEvtSigTest();
+        n_bgd = dataset->GetNEvtBkgdTest();
+    }else if(type == TMVA::Types::kTraining){
+        n_sig = dataset->GetNEvtSigTrain();
+        n_bgd = dataset->GetNEvtBkgdTrain();
+    }else{
+        throw runtime_error("Unexpected treeType (must be either kTesting or kTraining).");
+    }
+}
+
 /* Utility function for converting from ROOT's DataSetInfo instance, to xgboost's DMatrix representation.
  * Furthermore,
  * (i)   We also extract the number of signal and background events.
@@ -135,59 +389,250 @@ xgboost_data* ROOTToXGBoost(TTree& signal_tree, TTree& background_tree, vector<s
  *
  * All this data is wrapped in an xgboost_data instance, the internals of which can be used with xgboost's C-api.
  *
- * The passed vector<string> of variable names specifies which branches to extract from the respective TTree instances.
+ * The fill mode selects how the event values are copied (see xgboost_fill_mode); in kFillBlocked mode, the copy is
+ * carried out by the threads of the given executor, or by all the threads of the implicit multi-threading pool (through
+ * an executor constructed for this conversion) if none is given.
  */
-xgboost_data* ROOTToXGBoost(const TMVA::DataSetInfo& dataset_info, TMVA::Types::ETreeType type){
+xgboost_data* ROOTToXGBoost(const TMVA::DataSetInfo& dataset_info, TMVA::Types::ETreeType type,
+                            xgboost_fill_mode fill_mode = kFillBlocked, ROOT::TThreadExecutor* pool = nullptr){
     TMVA::DataSet* dataset = dataset_info.GetDataSet(); // reference to DataSet instance being filtered
 
     const auto n_vars = dataset->GetNVariables(); // get number of variables
     Long64_t n_sig, n_bgd; // maintain the number of signal and background events respectively
 
     // Depending on whether we are keeping testing or training events, set the number of such signal and background events
-    if(type == TMVA::Types::kTesting){
-        n_sig = dataset->GetNEvtSigTest();
-        n_bgd = dataset->GetNEvtBkgdTest();
-    }else if(type == TMVA::Types::kTraining){
-        n_sig = dataset->GetNEvtSigTrain();
-        n_bgd = dataset->GetNEvtBkgdTrain();
+    count_xgboost_events(dataset, type, n_sig, n_bgd);
+
+    // Initialise a (heap allocated) row-major Float_t buffer to hold a 2-dim representation of the signal and
+    // background trees
+    vector<Float_t> sb_mat((n_sig + n_bgd) * n_vars);
+
+    auto data = new xgboost_data(n_sig, n_bgd); // maintains xgboost readable data
+
+    // Notice here that unlike the TTree variant of the function, the rows will be mixed signal and background events
+    const vector<TMVA::Event*>& events = dataset->GetEventCollection(type);
+    if(fill_mode == kFillPerCell){
+        fill_xgboost_rows_per_cell(dataset_info, events, 0, n_sig + n_bgd, n_vars, sb_mat.data(), data->labels,
+                                   data->weights);
+    }else if(pool != nullptr){
+        fill_xgboost_rows_parallel(dataset_info, events, n_sig + n_bgd, n_vars, sb_mat.data(), data->labels,
+                                   data->weights, *pool);
     }else{
-        throw runtime_error("Unexpected treeType (must be either kTesting or kTraining).");
+        ROOT::TThreadExecutor conversion_pool;
+        fill_xgboost_rows_parallel(dataset_info, events, n_sig + n_bgd, n_vars, sb_mat.data(), data->labels,
+                                   data->weights, conversion_pool);
     }
 
-    // Initialise Float_t array to hold a 2-dim representation of the signal and background trees
-    Float_t sb_mat[n_sig + n_bgd][n_vars];
+    // Populate the DMatrix datastructure held in the xgboost_data instance...
+    safe_xgboost(XGDMatrixCreateFromMat(sb_mat.data(), n_sig + n_bgd, n_vars, 0, &((data->sb_dmats)[0])))
+    safe_xgboost(XGDMatrixSetFloatInfo((data->sb_dmats)[0], "label", data->labels, n_sig + n_bgd))
 
-    auto data = new xgboost_data(n_sig, n_bgd); // maintains xgboost readable data
+    return data;
+}
 
-    Long64_t i = 0;
-    for(auto& event: dataset->GetEventCollection(type)){ // Notice here that unlike the TTree variant of the function,
-                                                         // the rows will be mixed signal and background events
-        // Populate the 2d matrix...
-        for(Long64_t j = 0; j < n_vars; j++){
-            sb_mat[i][j] = event->GetValue(j);
+/* State of a streaming (chunked) conversion to a DMatrix, driven through XGBoost's data iterator interface
+ * (XGDMatrixCreateFromCallback). On each call of xgboost_chunk_next, the fill function copies at most chunk_size events
+ * into fixed-size row-major buffers, which are handed over to XGBoost via a proxy DMatrix. XGBoost consumes the chunks
+ * into its external memory pages, so that the peak memory held by the conversion is bounded by the chunk size rather
+ * than by the size of the data set. The pages are stored in a directory of their own (cache_dir), which is removed
+ * along with the iterator.
+ *
+ * The callbacks are called from within XGBoost's C API, which exceptions must not cross: an exception raised while
+ * filling a chunk is caught, its message is kept in error and the iteration is ended, such that the conversion can
+ * throw it once XGDMatrixCreateFromCallback has returned (see xgboost_create_from_chunks).
+ */
+typedef struct xgboost_chunk_iter{
+    // Copies the values and labels of the events [begin, end) into the given rows and labels buffers
+    typedef function<void(Long64_t begin, Long64_t end, Float_t* rows, Float_t* labels)> fill_t;
+
+    fill_t fill;
+    Long64_t n_events;
+    UInt_t n_vars;
+    Long64_t chunk_size;
+    Long64_t pos = 0; // index of the first event of the next chunk
+    string error; // message of the exception raised by a callback, if any
+    string cache_dir; // directory holding the external memory pages, if created
+
+    DMatrixHandle proxy;
+    vector<Float_t> rows, labels; // fixed-size chunk buffers
+
+    xgboost_chunk_iter(fill_t fill, Long64_t n_events, UInt_t n_vars, Long64_t chunk_size)
+        : fill(move(fill)), n_events(n_events), n_vars(n_vars), chunk_size(chunk_size),
+          rows(chunk_size * n_vars), labels(chunk_size){
+        safe_xgboost(XGProxyDMatrixCreate(&proxy))
+    }
+} xgboost_chunk_iter;
+
+void xgboost_chunk_iter_free(xgboost_chunk_iter* iter){
+    safe_xgboost(XGDMatrixFree(iter->proxy))
+    if(!iter->cache_dir.empty()){
+        if(DIR* dir = opendir(iter->cache_dir.c_str())){
+            while(dirent* entry = readdir(dir)){
+                if(entry->d_name[0] != '.'){ unlink((iter->cache_dir + "/" + entry->d_name).c_str()); }
+            }
+            closedir(dir);
         }
+        rmdir(iter->cache_dir.c_str());
+    }
+    delete iter;
+}
 
+// Array interface description of a row-major (n_rows x n_cols) float buffer, through which XGBoost reads it in place.
+string xgboost_array_interface(const Float_t* rows, Long64_t n_rows, UInt_t n_cols){
+    return "{\"data\": [" + to_string((size_t) rows) + ", false], \"shape\": [" + to_string(n_rows) + ", "
+           + to_string(n_cols) + "], \"typestr\": \"<f4\", \"version\": 3}";
+}
 
-        if(dataset_info.IsSignal(event)){ // Set the weight for the signal data, and the labels to 0.0
-            (data->labels)[i] = 0.0;
-            (data->weights)[i] = event->GetOriginalWeight();
-        }else{
-            (data->labels)[i] = 1.0; // Set the weight for the background data, and the labels to 1.0
-            (data->weights)[i] = event->GetOriginalWeight();
-        }
+/* XGBoost data iterator callback: fills the proxy DMatrix with the next chunk, returning 0 once no events are left or
+ * an error occurred (recorded in the iterator), and 1 otherwise.
+ */
+int xgboost_chunk_next(DataIterHandle handle){
+    auto iter = static_cast<xgboost_chunk_iter*>(handle);
+    if(iter->pos >= iter->n_events || !iter->error.empty()){ return 0; }
+
+    try{
+        const Long64_t end = min(iter->pos + iter->chunk_size, iter->n_events);
+        const Long64_t n_rows = end - iter->pos;
+        iter->fill(iter->pos, end, iter->rows.data(), iter->labels.data());
+
+        // Describe the chunk buffer using the array interface protocol, which the proxy DMatrix references without a copy
+        string array_interface = xgboost_array_interface(iter->rows.data(), n_rows, iter->n_vars);
+        safe_xgboost(XGProxyDMatrixSetDataDense(iter->proxy, array_interface.c_str()))
+        safe_xgboost(XGDMatrixSetFloatInfo(iter->proxy, "label", iter->labels.data(), n_rows))
+
+        iter->pos = end;
+    }catch(const exception& e){
+        iter->error = e.what();
+        return 0;
+    }
+
+    return 1;
+}
 
-        i++;
+// XGBoost data iterator callback: rewinds the iterator to the first event.
+void xgboost_chunk_reset(DataIterHandle handle){
+    static_cast<xgboost_chunk_iter*>(handle)->pos = 0;
+}
+
+/* Builds the external memory DMatrix of data by pulling all the chunks of the given iterator, which data takes
+ * ownership of. The pages are stored in a new directory named after cache_prefix (cache_prefix.XXXXXX), such that
+ * concurrent conversions, within a process or across processes, never share pages. Throws, after releasing data, if
+ * the directory could not be created, or if either XGBoost or one of the callbacks failed.
+ */
+void xgboost_create_from_chunks(xgboost_data* data, xgboost_chunk_iter* iter, const string& cache_prefix){
+    data->chunk_iter = iter;
+    data->sb_dmats[0] = nullptr;
+
+    string dir_template = cache_prefix + ".XXXXXX";
+    if(mkdtemp(&dir_template[0]) == nullptr){
+        xgboost_chunk_iter_free(iter);
+        delete data;
+        throw runtime_error("Could not create a DMatrix page directory from " + cache_prefix);
     }
+    iter->cache_dir = dir_template;
+
+    string config = "{\"missing\": NaN, \"cache_prefix\": \"" + iter->cache_dir + "/dmatrix\"}";
+    int err = XGDMatrixCreateFromCallback(iter, iter->proxy, xgboost_chunk_reset, xgboost_chunk_next, config.c_str(),
+                                          &((data->sb_dmats)[0]));
+    if(err != 0 || !iter->error.empty()){
+        const string message = !iter->error.empty() ? iter->error : XGBGetLastError();
+        if(err == 0){ XGDMatrixFree(data->sb_dmats[0]); }
+        xgboost_chunk_iter_free(iter);
+        delete data;
+        throw runtime_error("Streaming conversion to a DMatrix failed: " + message);
+    }
+}
 
-    // Populate the DMatrix datastructure held in the xgboost_data instance...
-    safe_xgboost(XGDMatrixCreateFromMat((Float_t*) sb_mat, n_sig + n_bgd, n_vars, 0, &((data->sb_dmats)[0])))
-    safe_xgboost(XGDMatrixSetFloatInfo((data->sb_dmats)[0], "label", data->labels, n_sig + n_bgd))
+/* Streaming variant of the DataSetInfo conversion above: rather than materialising the whole data set as a single
+ * matrix, the events are fed to XGBoost in chunks of (at most) chunk_size events through XGBoost's callback interface,
+ * which builds an external memory DMatrix whose pages are cached on disk, in a directory of their own named after the
+ * given cache_prefix (and removed by free()).
+ *
+ * Note that the labels are only held by the DMatrix itself; the labels and weights arrays of the returned
+ * xgboost_data instance are not allocated in this mode. The events are however read from the DataSet, which TMVA holds
+ * in memory as a whole; see the TTree variant below for a conversion which reads the events from the trees.
+ */
+xgboost_data* ROOTToXGBoost(const TMVA::DataSetInfo& dataset_info, TMVA::Types::ETreeType type, Long64_t chunk_size,
+                            const string& cache_prefix = "bdt_xgb_bench_cache"){
+    if(chunk_size <= 0){
+        throw runtime_error("Chunk size must be positive for the streaming conversion.");
+    }
+
+    TMVA::DataSet* dataset = dataset_info.GetDataSet(); // reference to DataSet instance being filtered
+
+    Long64_t n_sig, n_bgd; // maintain the number of signal and background events respectively
+    count_xgboost_events(dataset, type, n_sig, n_bgd);
+
+    const vector<TMVA::Event*>& events = dataset->GetEventCollection(type);
+    const UInt_t n_vars = dataset->GetNVariables();
+    auto fill = [&dataset_info, &events, n_vars](Long64_t begin, Long64_t end, Float_t* rows, Float_t* labels){
+        vector<Float_t> weights(end - begin); // not part of the DMatrix
+        fill_xgboost_rows(dataset_info, events, begin, end, n_vars, rows, labels, weights.data());
+    };
+
+    auto data = new xgboost_data(n_sig, n_bgd, false); // maintains xgboost readable data
+    xgboost_create_from_chunks(data, new xgboost_chunk_iter(fill, n_sig + n_bgd, n_vars, chunk_size), cache_prefix);
 
     return data;
 }
 
-// Simple trainer using the XGBoost C-api, which returns a trained BoosterHandle instance.
-BoosterHandle xgboost_train(xgboost_data* data, xgbooster_opts* opts, UInt_t n_iter){
+/* Streaming variant of the TTree conversion: the entries of the signal tree, followed by the ones of the background
+ * tree, are read from the trees in chunks of (at most) chunk_size events, and fed to XGBoost as for the streaming
+ * DataSetInfo conversion. Unlike the latter, no copy of the data set is held in memory at any point, so that the
+ * memory held by the conversion is bounded by the chunk size (and the baskets of the trees). The trees must stay alive
+ * (and their files open) for as long as the DMatrix is used, as XGBoost may iterate over the chunks again.
+ *
+ * As for the in-memory TTree conversion, only the labels (0.0 for signal and 1.0 for background) are set on the DMatrix.
+ */
+xgboost_data* ROOTToXGBoost(TTree& signal_tree, TTree& background_tree, const vector<string>& variables,
+                            Long64_t chunk_size, const string& cache_prefix = "bdt_xgb_bench_cache"){
+    if(chunk_size <= 0){
+        throw runtime_error("Chunk size must be positive for the streaming conversion.");
+    }
+
+    const Long64_t n_sig = signal_tree.GetEntries();
+    const Long64_t n_bgd = background_tree.GetEntries();
+
+    // The first n_sig rows will be signal data, and the following n_bgd rows will be background data
+    auto fill = [&signal_tree, &background_tree, variables, n_sig, n_bgd](Long64_t begin, Long64_t end, Float_t* rows,
+                                                                          Float_t* labels){
+        const Long64_t sig_end = min(end, n_sig);
+        if(begin < sig_end){
+            fill_xgboost_rows_from_tree(signal_tree, variables, begin, sig_end, 0.0, rows, labels);
+        }
+
+        const Long64_t bgd_begin = max(begin, n_sig);
+        if(bgd_begin < end){
+            const Long64_t offset = bgd_begin - begin;
+            fill_xgboost_rows_from_tree(background_tree, variables, bgd_begin - n_sig, min(end - n_sig, n_bgd), 1.0,
+                                        rows + offset * variables.size(), labels + offset);
+        }
+    };
+
+    auto data = new xgboost_data(n_sig, n_bgd, false); // maintains xgboost readable data
+    xgboost_create_from_chunks(data, new xgboost_chunk_iter(fill, n_sig + n_bgd, variables.size(), chunk_size),
+                               cache_prefix);
+
+    return data;
+}
+
+/* Predicts the outputs of the booster for a row-major (n_rows x n_cols) float buffer in place, i.e. without building a
+ * DMatrix (XGBoosterPredictFromDense). The returned array is owned by the booster, and valid until its next prediction.
+ */
+const Float_t* xgboost_predict_dense(BoosterHandle booster, const Float_t* rows, Long64_t n_rows, UInt_t n_cols){
+    static const char config[] = "{\"type\": 0, \"training\": false, \"iteration_begin\": 0, \"iteration_end\": 0, "
+                                 "\"strict_shape\": false, \"cache_id\": 0, \"missing\": NaN}";
+    const bst_ulong* out_shape;
+    bst_ulong out_dim;
+    const Float_t* out_result;
+    string array_interface = xgboost_array_interface(rows, n_rows, n_cols);
+    safe_xgboost(XGBoosterPredictFromDense(booster, array_interface.c_str(), config, nullptr, &out_shape, &out_dim,
+                                           &out_result))
+    return out_result;
+}
+
+// Creates a BoosterHandle instance for the given training data, setting the specified options
+BoosterHandle xgboost_create_booster(xgboost_data* data, xgbooster_opts* opts){
     BoosterHandle booster;
     safe_xgboost(XGBoosterCreate(data->sb_dmats, 1, &booster)) // Initialise a BoosterHandle instance
 
@@ -195,13 +640,77 @@ BoosterHandle xgboost_train(xgboost_data* data, xgbooster_opts* opts, UInt_t n_i
         safe_xgboost(XGBoosterSetParam(booster, opt.first, opt.second))
     }
 
-    // Then train the booster for the specified number of iterations
+    return booster;
+}
+
+// Trains the booster on the given data for the specified number of boosting rounds
+void xgboost_boost(BoosterHandle booster, xgboost_data* data, UInt_t n_iter){
     for(UInt_t iter = 0; iter < n_iter; iter++){
         safe_xgboost(XGBoosterUpdateOneIter(booster, iter, (data->sb_dmats)[0]))
     }
+}
+
+// Simple trainer using the XGBoost C-api, which returns a trained BoosterHandle instance.
+BoosterHandle xgboost_train(xgboost_data* data, xgbooster_opts* opts, UInt_t n_iter){
+    BoosterHandle booster = xgboost_create_booster(data, opts);
+    xgboost_boost(booster, data, n_iter);
 
     return booster;
 }
 
+/* Model formats of XGBoost: the legacy binary format, JSON, and Universal Binary JSON (UBJSON, the default format from
+ * XGBoost 2.0, which requires XGBoost 1.6).
+ */
+enum xgboost_model_format{ kModelBinary, kModelJSON, kModelUBJSON };
+
+const char* xgboost_model_format_name(xgboost_model_format format){
+    switch(format){
+        case kModelJSON: return "json";
+        case kModelUBJSON: return "ubj";
+        default: return "deprecated";
+    }
+}
+
+// Whether the XGBoost version the benchmarks are linked against can write (and read) the given model format.
+bool xgboost_model_format_supported(xgboost_model_format format){
+    int major, minor, patch;
+    XGBoostVersion(&major, &minor, &patch);
+    return format != kModelUBJSON || major > 1 || (major == 1 && minor >= 6);
+}
+
+/* Saves the booster to prefix.<ext> in the given format, returning the path of the model file, whose extension is the
+ * one from which XGBoosterLoadModel infers the format (json, ubj, or deprecated for the legacy binary format). From
+ * XGBoost 1.6 the format is selected explicitly, whereas older versions write the legacy binary format for anything but
+ * a .json file. Throws if the format is not supported.
+ */
+string xgboost_save_model(BoosterHandle booster, const string& prefix, xgboost_model_format format){
+    if(!xgboost_model_format_supported(format)){
+        throw runtime_error(string("XGBoost model format not supported by this version: ") +
+                            xgboost_model_format_name(format));
+    }
+
+    const string path = prefix + "." + xgboost_model_format_name(format);
+    if(!xgboost_model_format_supported(kModelUBJSON)){
+        safe_xgboost(XGBoosterSaveModel(booster, path.c_str()))
+        return path;
+    }
+
+    const string config = string("{\"format\": \"") + xgboost_model_format_name(format) + "\"}";
+    bst_ulong length;
+    const char* buffer;
+    safe_xgboost(XGBoosterSaveModelToBuffer(booster, config.c_str(), &length, &buffer))
+    ofstream out(path, ios::binary);
+    out.write(buffer, length);
+    if(!out){ throw runtime_error("Failed to write XGBoost model " + path); }
+    return path;
+}
+
+// Contents of the given (model) file, e.g. for XGBoosterLoadModelFromBuffer.
+string xgboost_read_file(const string& path){
+    ifstream in(path, ios::binary);
+    if(!in){ throw runtime_error("Failed to open " + path); }
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
 
 #endif //ROOT2XGBOOST_ROOT2XGBOOST_H
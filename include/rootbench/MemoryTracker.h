@@ -0,0 +1,60 @@
+///\file Allocation tracking, based on the interposition of the C allocation
+/// functions (which the default operator new/delete forward to).
+
+#ifndef RB_MEMORY_TRACKER_H
+#define RB_MEMORY_TRACKER_H
+
+#include <cstdint>
+
+namespace RB {
+  /// Allocation statistics of a tracked region.
+  struct AllocStats {
+    /// Total number of bytes requested from the allocator.
+    std::uint64_t fAllocatedBytes = 0;
+    /// Number of allocations (including reallocations).
+    std::uint64_t fAllocations = 0;
+    /// Highest number of bytes held at any point of the region, on top of
+    /// what was already held when the region started.
+    std::int64_t fPeakLiveBytes = 0;
+    /// Number of bytes held at the end of the region, on top of what was
+    /// already held when the region started (negative if memory allocated
+    /// before the region was released within it).
+    std::int64_t fLiveBytes = 0;
+  };
+
+  /// Returns true if allocations can be tracked on this platform (glibc),
+  /// otherwise all the statistics stay at zero.
+  bool IsAllocTrackingSupported();
+
+  /// Starts tracking the allocations of all threads, resetting the statistics.
+  /// Tracked regions cannot be nested.
+  void StartAllocTracking();
+
+  /// Stops tracking allocations, returning the statistics of the region since
+  /// the last call to StartAllocTracking.
+  AllocStats StopAllocTracking();
+
+  /// Tracks the allocations made during its lifetime (or until Stop is called).
+  ///
+  ///\code
+  /// RB::AllocTracker tracker;
+  /// ... // code to track
+  /// RB::AllocStats stats = tracker.Stop();
+  ///\endcode
+  ///
+  class AllocTracker {
+    bool fRunning = true;
+  public:
+    AllocTracker() { StartAllocTracking(); }
+    ~AllocTracker() { if (fRunning) StopAllocTracking(); }
+    AllocTracker(const AllocTracker &) = delete;
+    AllocTracker &operator=(const AllocTracker &) = delete;
+
+    AllocStats Stop() {
+      fRunning = false;
+      return StopAllocTracking();
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,79 @@
+///\file Hardware performance counters, based on the perf_event_open interface
+/// of Linux.
+
+#ifndef RB_PERF_COUNTERS_H
+#define RB_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RB {
+  /// Returns true if the hardware performance counters were requested, by
+  /// setting the RB_PERF_COUNTERS env variable to a non-zero value. Counting
+  /// is opt-in since it needs perf events to be permitted (see
+  /// /proc/sys/kernel/perf_event_paranoid), and takes up the PMU of the machine.
+  bool IsPerfCountersEnabled();
+
+  /// A set of hardware events counted over the regions between Start and Stop,
+  /// in all the threads of the process (including the ones created while
+  /// counting). Events which are not supported by the machine (or the
+  /// hypervisor) are left out, and if perf events are not permitted at all
+  /// IsValid returns false and GetError tells why.
+  ///
+  /// Events are opened as two groups (cycles, instructions and branch misses;
+  /// L1 data cache, last level cache and data TLB misses), such that the ratios
+  /// within a group are consistent even if the kernel has to multiplex them.
+  /// Multiplexed counts are scaled to the time the region was running.
+  ///
+  ///\code
+  /// RB::PerfCounters counters;
+  /// counters.Start();
+  /// ... // code to measure
+  /// counters.Stop();
+  /// for (auto &value : counters.Read())
+  ///   std::cout << value.fName << ": " << value.fCount << "\n";
+  ///\endcode
+  ///
+  class PerfCounters {
+  public:
+    struct Value {
+      std::string fName;
+      double fCount;
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool IsValid() const { return !fEvents.empty(); }
+    const std::string &GetError() const { return fError; }
+
+    /// Resets and enables the counters.
+    void Start();
+    /// Disables the counters.
+    void Stop();
+    /// Enables the counters again after Stop, without resetting them, such
+    /// that the counts add up over several regions.
+    void Resume();
+    /// Counts of the events opened, summed over all threads, in the order
+    /// Cycles, Instructions, Branch Misses, L1D Misses, LLC Misses, dTLB Misses.
+    std::vector<Value> Read() const;
+
+  private:
+    struct Event {
+      int fFd;
+      unsigned fKind;
+    };
+    struct Baseline {
+      std::uint64_t fValue, fEnabled, fRunning;
+    };
+    std::vector<Event> fEvents;
+    std::vector<Baseline> fBaseline;
+    std::vector<int> fLeaders;
+    std::string fError;
+  };
+}
+
+#endif
@@ -5,7 +5,7 @@
 #include <stdlib.h>
 
 #include "rootbench/ErrorHandling.h"
-#include <rootbench/Constants.h> // RB::kDatasetDirectory
+#include <rootbench/Constants.h> // RB::kDatasetDirectory, RB::kCXXCompiler
 #include <string>
 
 namespace RB {
@@ -33,6 +33,16 @@ namespace RB {
       return RB::kDatasetDirectory;
   }
 
+  /// Returns the C++ compiler used to compile code generated at run time. This is
+  /// the compiler rootbench was built with, unless overridden by the RB_CXX env
+  /// variable.
+  inline std::string GetCXXCompiler() {
+    if (char* cxx = std::getenv("RB_CXX"))
+      return cxx;
+
+    return RB::kCXXCompiler;
+  }
+
   /// Like assert, but it does not disappear if -DNDEBUG
   inline void Ensure(bool b)
   {
@@ -0,0 +1,157 @@
+///\file Interposes malloc and friends to track allocations, see
+/// rootbench/MemoryTracker.h.
+///
+/// The definitions below take precedence over the C library's for the whole
+/// process (including the shared libraries it loads), and forward to glibc's
+/// internal entry points. Sizes released are obtained with malloc_usable_size,
+/// so live bytes are accounted in usable sizes on both ends. Tracking is
+/// switched on and off through a flag, such that untracked code only pays for
+/// one relaxed atomic load per call.
+
+#include "rootbench/MemoryTracker.h"
+
+#include <atomic>
+
+#if defined(__GLIBC__)
+#include <cerrno>
+#include <malloc.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void *__libc_valloc(size_t size);
+void *__libc_pvalloc(size_t size);
+void __libc_free(void *ptr);
+}
+#endif
+
+namespace {
+  std::atomic<bool> gTracking{false};
+  std::atomic<std::uint64_t> gAllocatedBytes{0};
+  std::atomic<std::uint64_t> gAllocations{0};
+  std::atomic<std::int64_t> gLiveBytes{0};
+  std::atomic<std::int64_t> gPeakLiveBytes{0};
+}
+
+#if defined(__GLIBC__)
+namespace {
+  void RecordAlloc(void *ptr, size_t requested) {
+    if (!ptr || !gTracking.load(std::memory_order_relaxed))
+      return;
+    gAllocatedBytes.fetch_add(requested, std::memory_order_relaxed);
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    std::int64_t usable = malloc_usable_size(ptr);
+    std::int64_t live = gLiveBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+    std::int64_t peak = gPeakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !gPeakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+      ;
+  }
+
+  // Usable size of a block about to be released, looked up only while
+  // tracking (0 otherwise).
+  std::int64_t ReleasedSize(void *ptr) {
+    if (!ptr || !gTracking.load(std::memory_order_relaxed))
+      return 0;
+    return malloc_usable_size(ptr);
+  }
+
+  void RecordFree(std::int64_t usable) {
+    if (!usable || !gTracking.load(std::memory_order_relaxed))
+      return;
+    gLiveBytes.fetch_sub(usable, std::memory_order_relaxed);
+  }
+}
+
+extern "C" {
+void *malloc(size_t size) {
+  void *ptr = __libc_malloc(size);
+  RecordAlloc(ptr, size);
+  return ptr;
+}
+
+void *calloc(size_t n, size_t size) {
+  void *ptr = __libc_calloc(n, size);
+  RecordAlloc(ptr, n * size);
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+  std::int64_t usable = ReleasedSize(ptr);
+  void *newPtr = __libc_realloc(ptr, size);
+  // On failure the original block is left untouched, and hence still live.
+  if (newPtr || !size) {
+    RecordFree(usable);
+    RecordAlloc(newPtr, size);
+  }
+  return newPtr;
+}
+
+void free(void *ptr) {
+  RecordFree(ReleasedSize(ptr));
+  __libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  void *ptr = __libc_memalign(alignment, size);
+  RecordAlloc(ptr, size);
+  return ptr;
+}
+
+void *valloc(size_t size) {
+  void *ptr = __libc_valloc(size);
+  RecordAlloc(ptr, size);
+  return ptr;
+}
+
+void *pvalloc(size_t size) {
+  void *ptr = __libc_pvalloc(size);
+  RecordAlloc(ptr, size);
+  return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+  if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+  void *ptr = memalign(alignment, size);
+  if (!ptr && size)
+    return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+}
+#endif
+
+bool RB::IsAllocTrackingSupported() {
+#if defined(__GLIBC__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void RB::StartAllocTracking() {
+  gAllocatedBytes = 0;
+  gAllocations = 0;
+  gLiveBytes = 0;
+  gPeakLiveBytes = 0;
+  gTracking = true;
+}
+
+RB::AllocStats RB::StopAllocTracking() {
+  gTracking = false;
+
+  AllocStats stats;
+  stats.fAllocatedBytes = gAllocatedBytes;
+  stats.fAllocations = gAllocations;
+  stats.fPeakLiveBytes = gPeakLiveBytes;
+  stats.fLiveBytes = gLiveBytes;
+  return stats;
+}
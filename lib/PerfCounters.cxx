@@ -0,0 +1,165 @@
+///\file Hardware performance counters, see rootbench/PerfCounters.h.
+
+#include "rootbench/PerfCounters.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  const char *const kEventNames[] = {"Cycles",     "Instructions", "Branch Misses",
+                                     "L1D Misses", "LLC Misses",   "dTLB Misses"};
+  constexpr unsigned kNumEvents = sizeof(kEventNames) / sizeof(kEventNames[0]);
+
+  /// Events [0, kSecondGroup) form the first group, the others the second.
+  constexpr unsigned kSecondGroup = 3;
+
+#ifdef __linux__
+  constexpr std::uint64_t CacheMiss(std::uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+
+  perf_event_attr MakeAttr(unsigned kind, bool leader) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    switch (kind) {
+    case 0: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case 1: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case 2: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case 3: attr.type = PERF_TYPE_HW_CACHE; attr.config = CacheMiss(PERF_COUNT_HW_CACHE_L1D); break;
+    case 4: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    default: attr.type = PERF_TYPE_HW_CACHE; attr.config = CacheMiss(PERF_COUNT_HW_CACHE_DTLB); break;
+    }
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Members follow their leader, which is enabled explicitly by Start.
+    attr.disabled = leader;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return attr;
+  }
+
+  int OpenEvent(unsigned kind, pid_t tid, int leader) {
+    perf_event_attr attr = MakeAttr(kind, leader == -1);
+    return syscall(SYS_perf_event_open, &attr, tid, -1, leader, PERF_FLAG_FD_CLOEXEC);
+  }
+
+  struct Reading {
+    std::uint64_t fValue, fEnabled, fRunning;
+  };
+
+  bool ReadEvent(int fd, Reading &r) {
+    return read(fd, &r, sizeof(r)) == sizeof(r);
+  }
+#endif
+}
+
+bool RB::IsPerfCountersEnabled() {
+  const char *env = std::getenv("RB_PERF_COUNTERS");
+  return env && *env && std::strcmp(env, "0") != 0;
+}
+
+#ifdef __linux__
+RB::PerfCounters::PerfCounters() {
+  // Threads which already exist (e.g. thread pools) are counted separately,
+  // the ones created later are counted by inheritance.
+  std::vector<pid_t> tids;
+  if (DIR *dir = opendir("/proc/self/task")) {
+    while (dirent *entry = readdir(dir))
+      if (entry->d_name[0] != '.')
+        tids.push_back(std::atoi(entry->d_name));
+    closedir(dir);
+  }
+  if (tids.empty())
+    tids.push_back(0);
+
+  for (pid_t tid : tids) {
+    for (unsigned begin : {0u, kSecondGroup}) {
+      const unsigned end = begin ? kNumEvents : kSecondGroup;
+      int leader = -1;
+      for (unsigned kind = begin; kind < end; ++kind) {
+        int fd = OpenEvent(kind, tid, leader);
+        if (fd < 0) {
+          if (fError.empty())
+            fError = std::string("perf_event_open failed for ") + kEventNames[kind] + ": " + std::strerror(errno);
+          continue;
+        }
+        if (leader == -1) {
+          leader = fd;
+          fLeaders.push_back(fd);
+        }
+        fEvents.push_back({fd, kind});
+      }
+    }
+  }
+
+  if (!fEvents.empty())
+    fError.clear();
+  fBaseline.resize(fEvents.size());
+}
+
+RB::PerfCounters::~PerfCounters() {
+  for (const Event &event : fEvents)
+    close(event.fFd);
+}
+
+void RB::PerfCounters::Start() {
+  // Counts of inherited events are only reset for the live threads, hence the
+  // baseline rather than PERF_EVENT_IOC_RESET.
+  for (size_t i = 0; i < fEvents.size(); ++i) {
+    Reading r{0, 0, 0};
+    ReadEvent(fEvents[i].fFd, r);
+    fBaseline[i] = {r.fValue, r.fEnabled, r.fRunning};
+  }
+  for (int fd : fLeaders)
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void RB::PerfCounters::Stop() {
+  for (int fd : fLeaders)
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void RB::PerfCounters::Resume() {
+  for (int fd : fLeaders)
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+std::vector<RB::PerfCounters::Value> RB::PerfCounters::Read() const {
+  double counts[kNumEvents] = {};
+  bool opened[kNumEvents] = {};
+  for (size_t i = 0; i < fEvents.size(); ++i) {
+    Reading r;
+    if (!ReadEvent(fEvents[i].fFd, r))
+      continue;
+    const std::uint64_t value = r.fValue - fBaseline[i].fValue;
+    const std::uint64_t enabled = r.fEnabled - fBaseline[i].fEnabled;
+    const std::uint64_t running = r.fRunning - fBaseline[i].fRunning;
+    opened[fEvents[i].fKind] = true;
+    if (running)
+      counts[fEvents[i].fKind] += (double)value * enabled / running;
+  }
+
+  std::vector<Value> values;
+  for (unsigned kind = 0; kind < kNumEvents; ++kind)
+    if (opened[kind])
+      values.push_back({kEventNames[kind], counts[kind]});
+  return values;
+}
+#else
+RB::PerfCounters::PerfCounters() : fError("perf events are only available on Linux") {}
+RB::PerfCounters::~PerfCounters() {}
+void RB::PerfCounters::Start() {}
+void RB::PerfCounters::Stop() {}
+void RB::PerfCounters::Resume() {}
+std::vector<RB::PerfCounters::Value> RB::PerfCounters::Read() const { return {}; }
+#endif